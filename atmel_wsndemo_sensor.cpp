@@ -94,7 +94,7 @@ void DeRestPluginPrivate::wsnDemoDataIndication(const deCONZ::ApsDataIndication
 
                 if (updated)
                 {
-                    updateEtag(i->etag);
+                    updateSensorEtag(&*i);
                 }
 
                 return;
@@ -112,8 +112,9 @@ void DeRestPluginPrivate::wsnDemoDataIndication(const deCONZ::ApsDataIndication
         sensor.setLux(illuminance);
         sensor.setTemperature(temperature);
         */
-        updateEtag(sensor.etag);
         sensors.push_back(sensor);
+        indexSensorNode(&sensors.back());
+        updateSensorEtag(&sensors.back());
     }
 
 }
@@ -103,33 +103,24 @@ bool DeRestPluginPrivate::checkApikeyAuthentification(const ApiRequest &req, Api
         return true;
     }
 
-    std::vector<ApiAuth>::iterator i = apiAuths.begin();
-    std::vector<ApiAuth>::iterator end = apiAuths.end();
+    ApiAuth *auth = getApiAuthForKey(apikey);
 
-    for (; i != end; ++i)
+    if (auth)
     {
-        if (apikey == i->apikey && i->state == ApiAuth::StateNormal)
-        {
-            i->lastUseDate = QDateTime::currentDateTimeUtc();
-
-            // fill in useragent string if not already exist
-            if (i->useragent.isEmpty())
-            {
-                if (req.hdr.hasKey("User-Agent"))
-                {
-                    i->useragent = req.hdr.value("User-Agent");
-                    DBG_Printf(DBG_HTTP, "set useragent '%s' for apikey '%s'\n", qPrintable(i->useragent), qPrintable(i->apikey));
-                }
-            }
+        auth->lastUse = steadyTimeRef(); // folded into lastUseDate by flushApiAuthLastUse()
 
-            i->needSaveDatabase = true;
-            if (!apiAuthSaveDatabaseTime.isValid() || apiAuthSaveDatabaseTime.elapsed() > (1000 * 60 * 30))
+        // fill in useragent string if not already exist
+        if (auth->useragent.isEmpty())
+        {
+            if (req.hdr.hasKey("User-Agent"))
             {
-                apiAuthSaveDatabaseTime.start();
+                auth->useragent = req.hdr.value("User-Agent");
+                auth->needSaveDatabase = true;
                 queSaveDb(DB_AUTH, DB_HUGE_SAVE_DELAY);
+                DBG_Printf(DBG_HTTP, "set useragent '%s' for apikey '%s'\n", qPrintable(auth->useragent), qPrintable(auth->apikey));
             }
-            return true;
         }
+        return true;
     }
 
 #if 0
@@ -154,6 +145,90 @@ bool DeRestPluginPrivate::checkApikeyAuthentification(const ApiRequest &req, Api
     return false;
 }
 
+/*! Returns the active ApiAuth for \p apikey or 0 if not found.
+ */
+ApiAuth *DeRestPluginPrivate::getApiAuthForKey(const QString &apikey)
+{
+    QHash<QString, size_t>::const_iterator h = apiAuthIndex.constFind(apikey);
+    if (h != apiAuthIndex.constEnd() && h.value() < apiAuths.size())
+    {
+        ApiAuth *auth = &apiAuths[h.value()];
+        if (auth->state == ApiAuth::StateNormal && auth->apikey == apikey)
+        {
+            return auth;
+        }
+    }
+
+    return 0;
+}
+
+/*! Adds or removes apiAuths[\p idx] to/from the api key index according to its state.
+ */
+void DeRestPluginPrivate::indexApiAuth(size_t idx)
+{
+    DBG_Assert(idx < apiAuths.size());
+    if (idx >= apiAuths.size())
+    {
+        return;
+    }
+
+    const ApiAuth &auth = apiAuths[idx];
+
+    if (auth.state == ApiAuth::StateNormal)
+    {
+        apiAuthIndex.insert(auth.apikey, idx);
+    }
+    else
+    {
+        QHash<QString, size_t>::iterator h = apiAuthIndex.find(auth.apikey);
+        if (h != apiAuthIndex.end() && h.value() == idx)
+        {
+            apiAuthIndex.erase(h);
+        }
+    }
+}
+
+/*! Folds the last use of all api keys into their lastUseDate with minute granularity.
+    Keeps the per request authentification free of wall clock and database bookkeeping.
+    \return true if any ApiAuth needs to be saved to the database
+ */
+bool DeRestPluginPrivate::flushApiAuthLastUse()
+{
+    const SteadyTimeRef now = steadyTimeRef();
+    qint64 utcNow = 0;
+    bool changed = false;
+
+    std::vector<ApiAuth>::iterator i = apiAuths.begin();
+    std::vector<ApiAuth>::iterator end = apiAuths.end();
+
+    for (; i != end; ++i)
+    {
+        if (i->state != ApiAuth::StateNormal || !i->lastUse.isValid() || i->lastUse == i->lastUseFlushed)
+        {
+            continue;
+        }
+
+        if (utcNow == 0)
+        {
+            utcNow = QDateTime::currentMSecsSinceEpoch();
+        }
+
+        i->lastUseFlushed = i->lastUse;
+        qint64 lastUse = utcNow - i->lastUse.msecsTo(now);
+        lastUse -= lastUse % (60 * 1000); // minute granularity
+        QDateTime dt = QDateTime::fromMSecsSinceEpoch(lastUse, Qt::UTC);
+
+        if (dt != i->lastUseDate)
+        {
+            i->lastUseDate = dt;
+            i->needSaveDatabase = true;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
 /*! Encrypts a string with using crypt() MD5 + salt. (unix only)
     \param str the input string
     \return the encrypted string on success or the unchanged input string on fail
@@ -796,7 +796,7 @@ void DeRestPluginPrivate::checkSensorBindingsForAttributeReporting(Sensor *senso
         }
 
         if (val.timestampLastReport.isValid() &&
-            val.timestampLastReport.secsTo(QTime::currentTime()) < (60 * 45)) // got update in timely manner
+            val.timestampLastReport.secsTo(steadyTimeRef()) < (60 * 45)) // got update in timely manner
         {
             DBG_Printf(DBG_INFO_L2, "binding for attribute reporting of cluster 0x%04X seems to be active\n", (*i));
             continue;
@@ -1092,6 +1092,7 @@ void DeRestPluginPrivate::checkSensorGroup(Sensor *sensor)
     if (item->toString() != group->id())
     {
         item->setValue(group->id());
+        updateSensorEtag(sensor);
         sensor->setNeedSaveDatabase(true);
         queSaveDb(DB_SENSORS, DB_SHORT_SAVE_DELAY);
         Event e(RSensors, RConfigGroup, sensor->id());
@@ -1143,8 +1144,8 @@ void DeRestPluginPrivate::checkOldSensorGroups(Sensor *sensor)
 
                     // for each node which is part of this group send a remove group request (will be unicast)
                     // note: nodes which are curently switched off will not be removed!
-                    std::vector<LightNode>::iterator j = nodes.begin();
-                    std::vector<LightNode>::iterator jend = nodes.end();
+                    SlotMap<LightNode>::iterator j = nodes.begin();
+                    SlotMap<LightNode>::iterator jend = nodes.end();
 
                     for (; j != jend; ++j)
                     {
@@ -1156,6 +1157,7 @@ void DeRestPluginPrivate::checkOldSensorGroups(Sensor *sensor)
                             groupInfo->actions &= ~GroupInfo::ActionAddToGroup; // sanity
                             groupInfo->actions |= GroupInfo::ActionRemoveFromGroup;
                             groupInfo->state = GroupInfo::StateNotInGroup;
+                            indexLightGroups(&*j);
                         }
                     }
                 }
@@ -1181,8 +1183,8 @@ void DeRestPluginPrivate::deleteGroupsWithDeviceMembership(const QString &id)
 
             // for each node which is part of this group send a remove group request (will be unicast)
             // note: nodes which are curently switched off will not be removed!
-            std::vector<LightNode>::iterator j = nodes.begin();
-            std::vector<LightNode>::iterator jend = nodes.end();
+            SlotMap<LightNode>::iterator j = nodes.begin();
+            SlotMap<LightNode>::iterator jend = nodes.end();
 
             for (; j != jend; ++j)
             {
@@ -1194,6 +1196,7 @@ void DeRestPluginPrivate::deleteGroupsWithDeviceMembership(const QString &id)
                     groupInfo->actions &= ~GroupInfo::ActionAddToGroup; // sanity
                     groupInfo->actions |= GroupInfo::ActionRemoveFromGroup;
                     groupInfo->state = GroupInfo::StateNotInGroup;
+                    indexLightGroups(&*j);
                 }
             }
         }
@@ -1402,8 +1405,8 @@ void DeRestPluginPrivate::bindingToRuleTimerFired()
     }
 
 
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlotMap<Sensor>::iterator i = sensors.begin();
+    SlotMap<Sensor>::iterator end = sensors.end();
 
     Sensor *sensor = 0;
 
@@ -1634,7 +1637,7 @@ void DeRestPluginPrivate::bindingToRuleTimerFired()
             actions.push_back(action);
             conditions.push_back(cond);
 
-            updateEtag(rule.etag);
+            updateRuleEtag(&rule);
             rule.setOwner("deCONZ");
             rule.setCreationtime(QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddTHH:mm:ss"));
             rule.setActions(actions);
@@ -1733,6 +1736,7 @@ void DeRestPluginPrivate::bindingTableReaderTimerFired()
             if (apsCtrl && apsCtrl->apsdeDataRequest(apsReq) == deCONZ::Success)
             {
                 DBG_Printf(DBG_ZDP, "Mgmt_Bind_req id: %d to 0x%016llX send\n", i->apsReq.id(), i->apsReq.dstAddress().ext());
+                registerApsRequest(apsReq, ApsOwnerBindingTableReader);
                 i->time.start();
                 i->state = BindingTableReader::StateWaitConfirm;
                 break;
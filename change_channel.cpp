@@ -135,7 +135,7 @@ void DeRestPluginPrivate::changeChannel(quint8 channel)
 
             if (apsCtrl && apsCtrl->apsdeDataRequest(req) == deCONZ::Success)
             {
-                channelChangeApsRequestId = req.id();
+                registerApsRequest(req, ApsOwnerChannelChange);
                 DBG_Printf(DBG_INFO, "change channel to %d, channel mask = 0x%08lX\n", channel, scanChannels);
                 channelChangeState = CC_WaitConfirm;
                 channelchangeTimer->start(CC_CHANNELCHANGE_WAIT_CONFIRM_TIME);
@@ -253,6 +253,7 @@ static int sqliteLoadAuthCallback(void *user, int ncols, char **colval , char **
     if (!auth.apikey.isEmpty() && !auth.devicetype.isEmpty())
     {
         d->apiAuths.push_back(auth);
+        d->indexApiAuth(d->apiAuths.size() - 1);
     }
 
     return 0;
@@ -403,6 +404,15 @@ static int sqliteLoadConfigCallback(void *user, int ncols, char **colval , char
             }
         }
     }
+    else if (strcmp(colval[0], "websocketpolicy") == 0)
+    {
+        WebSocketServer::SlowClientPolicy policy;
+        if (WebSocketServer::policyFromString(val, &policy))
+        {
+            d->webSocketServer->setSlowClientPolicy(policy);
+            d->gwConfig["websocketpolicy"] = val;
+        }
+    }
     else if (strcmp(colval[0], "zigbeechannel") == 0)
     {
         if (!val.isEmpty())
@@ -725,7 +735,7 @@ static int sqliteLoadAllGroupsCallback(void *user, int ncols, char **colval , ch
         if (!g)
         {
             // append to cache if not already known
-            d->updateEtag(group.etag);
+            d->updateGroupEtag(&group);
             d->groups.push_back(group);
         }
     }
@@ -917,7 +927,7 @@ static int sqliteLoadAllScenesCallback(void *user, int ncols, char **colval , ch
             if (!s)
             {
                 // append scene to group if not already known
-                d->updateEtag(g->etag);
+                d->updateGroupEtag(g);
                 g->scenes.push_back(scene);
             }
         }
@@ -1268,8 +1278,8 @@ void DeRestPluginPrivate::loadLightNodeFromDb(LightNode *lightNode)
     // check for unique IDs
     if (!lightNode->id().isEmpty())
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -1506,7 +1516,7 @@ static int sqliteLoadAllRulesCallback(void *user, int ncols, char **colval , cha
         if (!r)
         {
             // append to cache if not already known
-            d->updateEtag(rule.etag);
+            d->updateRuleEtag(&rule);
             d->rules.push_back(rule);
         }
     }
@@ -1838,6 +1848,7 @@ static int sqliteLoadAllSensorsCallback(void *user, int ncols, char **colval , c
                 sensor.address().setExt(extAddr);
                 // append to cache if not already known
                 d->sensors.push_back(sensor);
+                d->indexSensorNode(&d->sensors.back());
                 d->updateSensorEtag(&d->sensors.back());
 
                 if (sensor.needSaveDatabase())
@@ -1959,8 +1970,8 @@ int DeRestPluginPrivate::getFreeLightId()
     lightIds.clear();
 
     { // append all ids from nodes known at runtime
-        std::vector<LightNode>::const_iterator i = nodes.begin();
-        std::vector<LightNode>::const_iterator end = nodes.end();
+        SlotMap<LightNode>::const_iterator i = nodes.begin();
+        SlotMap<LightNode>::const_iterator end = nodes.end();
         for (;i != end; ++i)
         {
             lightIds.push_back(i->id().toUInt());
@@ -2124,8 +2135,8 @@ int DeRestPluginPrivate::getFreeSensorId()
     sensorIds.clear();
 
     { // append all ids from nodes known at runtime
-        std::vector<Sensor>::const_iterator i = sensors.begin();
-        std::vector<Sensor>::const_iterator end = sensors.end();
+        SlotMap<Sensor>::const_iterator i = sensors.begin();
+        SlotMap<Sensor>::const_iterator end = sensors.end();
         for (;i != end; ++i)
         {
             sensorIds.push_back(i->id().toUInt());
@@ -2213,6 +2224,8 @@ void DeRestPluginPrivate::saveDb()
     // dump authentification
     if (saveDatabaseItems & DB_AUTH)
     {
+        flushApiAuthLastUse();
+
         std::vector<ApiAuth>::iterator i = apiAuths.begin();
         std::vector<ApiAuth>::iterator end = apiAuths.end();
 
@@ -2286,6 +2299,7 @@ void DeRestPluginPrivate::saveDb()
         gwConfig["announceinterval"] = (double)gwAnnounceInterval;
         gwConfig["announceurl"] = gwAnnounceUrl;
         gwConfig["groupdelay"] = gwGroupSendDelay;
+        gwConfig["websocketpolicy"] = WebSocketServer::policyToString(webSocketServer->slowClientPolicy());
         gwConfig["zigbeechannel"] = gwZigbeeChannel;
         gwConfig["gwusername"] = gwAdminUserName;
         gwConfig["gwpassword"] = gwAdminPasswordHash;
@@ -2441,8 +2455,8 @@ void DeRestPluginPrivate::saveDb()
     // save nodes
     if (saveDatabaseItems & DB_LIGHTS)
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -2839,8 +2853,8 @@ void DeRestPluginPrivate::saveDb()
     // save/delete sensors
     if (saveDatabaseItems & DB_SENSORS)
     {
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlotMap<Sensor>::iterator i = sensors.begin();
+        SlotMap<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -2910,6 +2924,7 @@ void DeRestPluginPrivate::saveDb()
     }
 
     sqlite3_exec(db, "COMMIT", 0, 0, 0);
+    perfCounters().dbSaveTime.record(measTimer.elapsed());
     DBG_Printf(DBG_INFO, "database saved in %ld ms\n", measTimer.elapsed());
 
 #ifdef Q_OS_LINUX
@@ -2943,6 +2958,11 @@ void DeRestPluginPrivate::queSaveDb(int items, int msec)
 {
     saveDatabaseItems |= items;
 
+    if (items & DB_SCHEDULES)
+    {
+        updateEtag(gwSchedulesEtag); // each schedule change is saved
+    }
+
     if (databaseTimer->isActive())
     {
         // prefer shorter interval
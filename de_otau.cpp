@@ -102,7 +102,7 @@ void DeRestPluginPrivate::otauDataIndication(const deCONZ::ApsDataIndication &in
                 version.sprintf("%08X", swVersion);
 
                 lightNode->setSwBuildId(version);
-                updateEtag(lightNode->etag);
+                updateLightEtag(lightNode);
 
                 // read real sw build id
                 lightNode->setLastRead(READ_SWBUILD_ID, idleTotalCounter);
@@ -355,17 +355,17 @@ void DeRestPluginPrivate::otauTimerFired()
 
     if (val.updateType == NodeValue::UpdateByZclRead)
     {
-        if (val.timestamp.isValid() && val.timestamp.elapsed() < OTAU_NOTIFY_INTERVAL)
+        if (val.timestamp.isValid() && val.timestamp.msecsTo(steadyTimeRef()) < OTAU_NOTIFY_INTERVAL)
         {
             return;
         }
 
-        if (val.timestampLastReadRequest.isValid() && val.timestampLastReadRequest.elapsed() < OTAU_NOTIFY_INTERVAL)
+        if (val.timestampLastReadRequest.isValid() && val.timestampLastReadRequest.msecsTo(steadyTimeRef()) < OTAU_NOTIFY_INTERVAL)
         {
             return;
         }
 
-        val.timestampLastReadRequest.start();
+        val.timestampLastReadRequest = steadyTimeRef();
     }
 
     otauSendStdNotify(lightNode);
@@ -79,6 +79,10 @@ else {
 QMAKE_CXXFLAGS += -Wno-attributes
 
 HEADERS  = bindings.h \
+           device_index.h \
+           group_index.h \
+           poll_scheduler.h \
+           perf_counters.h \
            connectivity.h \
            colorspace.h \
            de_web_plugin.h \
@@ -98,6 +102,7 @@ HEADERS  = bindings.h \
            rule.h \
            scene.h \
            sensor.h \
+           slot_map.h \
            websocket_server.h
 
 SOURCES  = authentification.cpp \
@@ -109,6 +114,10 @@ SOURCES  = authentification.cpp \
            database.cpp \
            discovery.cpp \
            de_web_plugin.cpp \
+           device_index.cpp \
+           group_index.cpp \
+           poll_scheduler.cpp \
+           perf_counters.cpp \
            de_web_widget.cpp \
            de_otau.cpp \
            event.cpp \
@@ -140,6 +149,7 @@ SOURCES  = authentification.cpp \
            permitJoin.cpp \
            scene.cpp \
            sensor.cpp \
+           task_scheduler.cpp \
            reset_device.cpp \
            rest_userparameter.cpp \
            zcl_tasks.cpp \
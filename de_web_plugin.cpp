@@ -8,6 +8,7 @@
  *
  */
 
+#include <QAbstractEventDispatcher>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDesktopServices>
@@ -21,9 +22,9 @@
 #include <QTcpSocket>
 #include <QHostAddress>
 #include <QUrl>
-#include <QCryptographicHash>
 #include <QFile>
 #include <QProcess>
+#include <algorithm>
 #include <queue>
 #include "colorspace.h"
 #include "de_web_plugin.h"
@@ -48,6 +49,7 @@ const char *HttpContentJS          = "text/javascript";
 const char *HttpContentPNG         = "image/png";
 const char *HttpContentJPG         = "image/jpg";
 const char *HttpContentSVG         = "image/svg+xml";
+const char *HttpContentText        = "text/plain; charset=utf-8";
 
 static int checkZclAttributesDelay = 750;
 //static int ReadAttributesLongDelay = 5000;
@@ -101,6 +103,13 @@ ApiRequest::ApiRequest(const QHttpRequestHeader &h, const QStringList &p, QTcpSo
     }
 }
 
+/*! Called by the event dispatcher when the event loop wakes up.
+ */
+void DeRestPluginPrivate::eventLoopAwake()
+{
+    updateSteadyTimeRef();
+}
+
 /*! Returns the apikey of a request or a empty string if not available
  */
 QString ApiRequest::apikey() const
@@ -113,6 +122,26 @@ QString ApiRequest::apikey() const
     return QString("");
 }
 
+/*! Returns the value of a URL query item or a empty string if not available.
+ */
+QString ApiRequest::queryItem(const QString &key) const
+{
+    const QStringList items = query.split('&', QString::SkipEmptyParts);
+    QStringList::const_iterator i = items.begin();
+    QStringList::const_iterator end = items.end();
+
+    for (; i != end; ++i)
+    {
+        const int pos = i->indexOf('=');
+        if (pos > 0 && i->left(pos) == key)
+        {
+            return i->mid(pos + 1);
+        }
+    }
+
+    return QString("");
+}
+
 /*! Constructor for pimpl.
     \param parent - the main plugin
  */
@@ -124,6 +153,14 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
 
     initEventQueue();
     initResourceDescriptors();
+    perfCounters().reset();
+
+    // refresh the cached monotonic time once per event loop iteration
+    if (QAbstractEventDispatcher::instance())
+    {
+        connect(QAbstractEventDispatcher::instance(), SIGNAL(awake()),
+                this, SLOT(eventLoopAwake()));
+    }
 
     connect(databaseTimer, SIGNAL(timeout()),
             this, SLOT(saveDatabaseTimerFired()));
@@ -152,10 +189,6 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     groupDeviceMembershipChecked = false;
     gwLinkButton = false;
 
-    // preallocate memory to get consistent pointers
-    nodes.reserve(150);
-    sensors.reserve(150);
-
     // Supported sensor types
     sensorTypes.append("CLIPSwitch");
     sensorTypes.append("CLIPOpenClose");
@@ -220,10 +253,17 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
         dummyReq.version = ApiVersion_1_DDEL;
         configToMap(dummyReq, gwConfig);
     }
+    etagVersion = randomCounterEpoch(); // versions of earlier runs are outside [etagBaseVersion, etagVersion]
+    etagBaseVersion = etagVersion;
+    gwSensorsVersion = 0;
+    gwLightsVersion = 0;
+    gwGroupsVersion = 0;
     updateEtag(gwConfigEtag);
     updateEtag(gwSensorsEtag);
     updateEtag(gwGroupsEtag);
     updateEtag(gwLightsEtag);
+    updateEtag(gwRulesEtag);
+    updateEtag(gwSchedulesEtag);
 
     gwProxyPort = 0;
     gwProxyAddress = "none";
@@ -288,11 +328,23 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
         DBG_Assert(ok);
     }
 
+    taskPriorityContext = TaskPriorityUser;
+    taskWindowGlobal = TaskWindow(TASK_WINDOW_INITIAL_GLOBAL, TASK_WINDOW_MAX_GLOBAL);
+    apsRequests.resize(APS_REQUEST_SLOTS);
+    broadcastBudget = TokenBucket(BROADCAST_BUDGET, BROADCAST_BUDGET_WINDOW / BROADCAST_BUDGET);
+    broadcastsSent = 0;
+    broadcastsDeferred = 0;
+    broadcastsDropped = 0;
+    runningTaskCount = 0;
     taskTimer = new QTimer(this);
-    taskTimer->setSingleShot(false);
+    taskTimer->setSingleShot(true); // started on demand by addTask() and deferred tasks
     connect(taskTimer, SIGNAL(timeout()),
             this, SLOT(processTasks()));
-    taskTimer->start(100);
+
+    readBatchTimer = new QTimer(this);
+    readBatchTimer->setSingleShot(true);
+    connect(readBatchTimer, SIGNAL(timeout()),
+            this, SLOT(flushReadBatches()));
 
     groupTaskTimer = new QTimer(this);
     groupTaskTimer->setSingleShot(false);
@@ -462,6 +514,7 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
                     if (item && !item->toBool())
                     {
                         item->setValue(true);
+                        updateSensorEtag(sensorNode);
                         Event e(RSensors, RConfigReachable, sensorNode->id());
                         enqueueEvent(e);
                     }
@@ -530,49 +583,80 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
  */
 void DeRestPluginPrivate::apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf)
 {
-    std::list<TaskItem>::iterator i = runningTasks.begin();
-    std::list<TaskItem>::iterator end = runningTasks.end();
+    ApsRequestSlot &slot = apsRequests[conf.id()];
 
-    for (;i != end; ++i)
+    if (slot.owner == ApsOwnerNone)
+    {
+        return; // not issued by this plugin or already timed out
+    }
+
+    const ApsRequestOwner owner = slot.owner;
+    const bool success = (conf.status() == deCONZ::ApsSuccessStatus);
+    slot.latency = slot.sendTime.msecsTo(steadyTimeRef());
+
+    if (owner == ApsOwnerTask)
     {
-        TaskItem &task = *i;
+        TaskItem &task = slot.task;
         if (conf.dstAddressMode() == deCONZ::ApsNwkAddress &&
             task.req.dstAddressMode() == deCONZ::ApsNwkAddress &&
             conf.dstAddress().hasNwk() && task.req.dstAddress().hasNwk() &&
             conf.dstAddress().nwk() != task.req.dstAddress().nwk())
         {
             DBG_Printf(DBG_INFO, "warn APSDE-DATA.confirm: 0x%02X nwk mismatch\n", conf.id());
-            //continue;
         }
 
-        if (task.req.id() == conf.id())
+        if (!success)
         {
-            if (conf.status() != deCONZ::ApsSuccessStatus)
-            {
-                DBG_Printf(DBG_INFO, "error APSDE-DATA.confirm: 0x%02X on task\n", conf.status());
-            }
-
-            DBG_Printf(DBG_INFO_L2, "Erase task zclSequenceNumber: %u send time %d\n", task.zclFrame.sequenceNumber(), idleTotalCounter - task.sendTime);
-            runningTasks.erase(i);
-            processTasks();
-
-            return;
+            DBG_Printf(DBG_INFO, "error APSDE-DATA.confirm: 0x%02X on task\n", conf.status());
         }
-    }
 
-    if (handleMgmtBindRspConfirm(conf))
-    {
+        DBG_Printf(DBG_INFO_L2, "Erase task zclSequenceNumber: %u after %d ms\n", task.zclFrame.sequenceNumber(), slot.latency);
+        finishRunningTask(conf.id(), &conf);
+        processTasks();
         return;
     }
 
-    if (channelChangeApsRequestId == conf.id())
+    slot.owner = ApsOwnerNone;
+
+    switch (owner)
     {
-        channelChangeSendConfirm(conf.status() == deCONZ::ApsSuccessStatus);
+    case ApsOwnerBindingTableReader:
+        handleMgmtBindRspConfirm(conf);
+        break;
+
+    case ApsOwnerChannelChange:
+        channelChangeSendConfirm(success);
+        break;
+
+    case ApsOwnerResetDevice:
+        resetDeviceSendConfirm(success);
+        break;
+
+    default:
+        break;
     }
-    if (resetDeviceApsRequestId == conf.id())
+}
+
+/*! Registers an APS request in the in-flight table so that its confirm is routed to \p owner.
+    A running task which still occupies the slot is dropped as timed out.
+    \param req - the request which was handed to the APS layer
+    \param owner - the receiver of the confirm
+    \return the slot of the request
+ */
+ApsRequestSlot &DeRestPluginPrivate::registerApsRequest(const deCONZ::ApsDataRequest &req, ApsRequestOwner owner)
+{
+    ApsRequestSlot &slot = apsRequests[req.id()];
+
+    if (slot.owner == ApsOwnerTask)
     {
-        resetDeviceSendConfirm(conf.status() == deCONZ::ApsSuccessStatus);
+        DBG_Printf(DBG_INFO, "APS request id %u reused before confirm, drop running task\n", req.id());
+        finishRunningTask(req.id(), 0);
     }
+
+    slot.owner = owner;
+    slot.sendTime = steadyTimeRef();
+    slot.latency = -1;
+    return slot;
 }
 
 /*! Process incoming green power button event.
@@ -616,44 +700,6 @@ void DeRestPluginPrivate::gpProcessButtonEvent(const deCONZ::GpDataIndication &i
     enqueueEvent(e);
 }
 
-/*! Returns the number of tasks for a specific address.
-    \param address - the destination address
- */
-int DeRestPluginPrivate::taskCountForAddress(const deCONZ::Address &address)
-{
-    int count = 0;
-
-    {
-        std::list<TaskItem>::const_iterator i = tasks.begin();
-        std::list<TaskItem>::const_iterator end = tasks.end();
-
-        for (; i != end; ++i)
-        {
-            if (i->req.dstAddress() == address)
-            {
-                count++;
-            }
-
-        }
-    }
-
-    {
-        std::list<TaskItem>::const_iterator i = runningTasks.begin();
-        std::list<TaskItem>::const_iterator end = runningTasks.end();
-
-        for (; i != end; ++i)
-        {
-            if (i->req.dstAddress() == address)
-            {
-                count++;
-            }
-
-        }
-    }
-
-    return count;
-}
-
 /*! Process incoming green power data frame.
     \param ind - the data indication
  */
@@ -817,6 +863,7 @@ void DeRestPluginPrivate::gpDataIndication(const deCONZ::GpDataIndication &ind)
 
             sensorNode.setNeedSaveDatabase(true);
             sensors.push_back(sensorNode);
+            indexSensorNode(&sensors.back());
 
             Event e(RSensors, REventAdded, sensorNode.id());
             enqueueEvent(e);
@@ -879,18 +926,75 @@ QVariantMap DeRestPluginPrivate::errorToMap(int id, const QString &ressource, co
 }
 
 /*! Creates a new unique ETag for a resource.
+    The ETag is the next value of a clock shared by all resources, so the
+    newest change always has the largest version.
+    \return the version of the new ETag
  */
-void DeRestPluginPrivate::updateEtag(QString &etag)
+quint64 DeRestPluginPrivate::updateEtag(QString &etag)
 {
-    QTime time = QTime::currentTime();
-#if QT_VERSION < 0x050000
-    etag = QString(QCryptographicHash::hash(time.toString().toAscii(), QCryptographicHash::Md5).toHex());
-#else
-    etag = QString(QCryptographicHash::hash(time.toString().toLatin1(), QCryptographicHash::Md5).toHex());
-#endif
+    etagVersion++;
     // quotes are mandatory as described in w3 spec
-    etag.prepend('"');
-    etag.append('"');
+    etag = QString("\"%1\"").arg(etagVersion);
+    return etagVersion;
+}
+
+/*! Sets the ETag of a GET response and compares it with the If-None-Match header.
+    Must be called before the response is built.
+    \return true if the client has the current version, the response is
+            then 304 Not Modified without a body
+ */
+bool DeRestPluginPrivate::checkEtag(const ApiRequest &req, ApiResponse &rsp, const QString &etag)
+{
+    rsp.etag = etag;
+
+    if (etag.isEmpty() || !req.hdr.hasKey(QLatin1String("If-None-Match")))
+    {
+        return false;
+    }
+
+    const QStringList tags = req.hdr.value(QLatin1String("If-None-Match")).split(',');
+    QStringList::const_iterator i = tags.begin();
+    QStringList::const_iterator end = tags.end();
+
+    for (; i != end; ++i)
+    {
+        QString tag = i->trimmed();
+        if (tag.startsWith(QLatin1String("W/"))) // weak comparison as in RFC 7232
+        {
+            tag.remove(0, 2);
+        }
+
+        if (tag == etag || tag == QLatin1String("*"))
+        {
+            rsp.httpStatus = HttpStatusNotModified;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*! Reads the since=<version> parameter of a delta request.
+    A version which can't be parsed is taken as 0 and gets all resources.
+    \return true if the request asks for the changes since a version
+ */
+bool DeRestPluginPrivate::sinceVersion(const ApiRequest &req, quint64 *since)
+{
+    const QString str = req.queryItem(QLatin1String("since"));
+
+    if (str.isEmpty())
+    {
+        return false;
+    }
+
+    bool ok;
+    *since = str.toULongLong(&ok);
+    if (!ok)
+    {
+        *since = 0;
+    }
+
+    return true;
 }
 
 /*! Returns the system uptime in seconds.
@@ -995,15 +1099,16 @@ void DeRestPluginPrivate::addLightNode(const deCONZ::Node *node)
                 queryTime = queryTime.addSecs(1);
 
                 //lightNode2->setLastRead(idleTotalCounter);
-                updateEtag(lightNode2->etag);
+                updateLightEtag(lightNode2);
             }
 
             if (lightNode2->uniqueId().isEmpty() || lightNode2->uniqueId().startsWith("0x"))
             {
                 QString uid = generateUniqueId(lightNode2->address().ext(), lightNode2->haEndpoint().endpoint(), 0);
                 lightNode2->setUniqueId(uid);
+                indexLightNode(lightNode2);
                 lightNode2->setNeedSaveDatabase(true);
-                updateEtag(lightNode2->etag);
+                updateLightEtag(lightNode2);
             }
 
             continue;
@@ -1151,6 +1256,7 @@ void DeRestPluginPrivate::addLightNode(const deCONZ::Node *node)
 
             nodes.push_back(lightNode);
             lightNode2 = &nodes.back();
+            indexLightNode(lightNode2);
 
             q->startZclAttributeTimer(checkZclAttributesDelay);
             updateLightEtag(lightNode2);
@@ -1177,8 +1283,8 @@ void DeRestPluginPrivate::nodeZombieStateChanged(const deCONZ::Node *node)
     bool available = !node->isZombie();
 
     { // lights
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -1213,8 +1319,8 @@ void DeRestPluginPrivate::nodeZombieStateChanged(const deCONZ::Node *node)
     }
 
     { // sensors
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlotMap<Sensor>::iterator i = sensors.begin();
+        SlotMap<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -1391,7 +1497,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                             }
 
                             lightNode->setHue(hue);
-                            ResourceItem *item = lightNode->item(RStateHue);
+                            ResourceItem *item = lightNode->item(RIdStateHue);
                             if (item && item->toNumber() != lightNode->enhancedHue())
                             {
                                 item->setValue(lightNode->enhancedHue());
@@ -1405,7 +1511,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                     else if (ia->id() == 0x0001) // current saturation
                     {
                         uint8_t sat = ia->numericValue().u8;
-                        ResourceItem *item = lightNode->item(RStateSat);
+                        ResourceItem *item = lightNode->item(RIdStateSat);
                         if (item && item->toNumber() != sat)
                         {
                             item->setValue(sat);
@@ -1421,7 +1527,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         // sanity for colorX
                         if (colorX > 65279) { colorX = 65279; }
 
-                        ResourceItem *item = lightNode->item(RStateX);
+                        ResourceItem *item = lightNode->item(RIdStateX);
                         if (item && item->toNumber() != colorX)
                         {
                             item->setValue(colorX);
@@ -1436,7 +1542,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         // sanity for colorY
                         if (colorY > 65279) { colorY = 65279; }
 
-                        ResourceItem *item = lightNode->item(RStateY);
+                        ResourceItem *item = lightNode->item(RIdStateY);
                         if (item && item->toNumber() != colorY)
                         {
                             item->setValue(colorY);
@@ -1448,7 +1554,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                     else if (ia->id() == 0x0007) // color temperature
                     {
                         uint16_t ct = ia->numericValue().u16;
-                        ResourceItem *item = lightNode->item(RStateCt);
+                        ResourceItem *item = lightNode->item(RIdStateCt);
 
                         if (item && item->toNumber() != ct)
                         {
@@ -1465,7 +1571,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                         const char *modes[3] = {"hs", "xy", "ct"};
                         if (cm < 3)
                         {
-                            ResourceItem *item = lightNode->item(RStateColorMode);
+                            ResourceItem *item = lightNode->item(RIdStateColorMode);
                             if (item && item->toString() != modes[cm])
                             {
                                 item->setValue(QVariant(modes[cm]));
@@ -1506,7 +1612,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                     if (ia->id() == 0x0000) // current level
                     {
                         uint8_t level = ia->numericValue().u8;
-                        ResourceItem *item = lightNode->item(RStateBri);
+                        ResourceItem *item = lightNode->item(RIdStateBri);
                         if (item && item->toNumber() != level)
                         {
                             DBG_Printf(DBG_INFO, "level %u --> %u\n", (uint)item->toNumber(), level);
@@ -1531,7 +1637,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
                     if (ia->id() == 0x0000) // OnOff
                     {
                         bool on = ia->numericValue().u8;
-                        ResourceItem *item = lightNode->item(RStateOn);
+                        ResourceItem *item = lightNode->item(RIdStateOn);
                         if (item && item->toBool() != on)
                         {
                             lightNode->clearRead(READ_ON_OFF);
@@ -1594,7 +1700,7 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
 
     if (updated)
     {
-        updateEtag(lightNode->etag);
+        updateLightEtag(lightNode);
         updateEtag(gwConfigEtag);
     }
 
@@ -1605,31 +1711,33 @@ LightNode *DeRestPluginPrivate::updateLightNode(const deCONZ::NodeEvent &event)
  */
 LightNode *DeRestPluginPrivate::getLightNodeForAddress(const deCONZ::Address &addr, quint8 endpoint)
 {
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
-
     if (addr.hasExt())
     {
-        for (; i != end; ++i)
+        const std::vector<size_t> &matches = (endpoint == 0) ? lightIndex.slotsForExt(addr.ext())
+                                                             : lightIndex.slotsForExtAndEndpoint(addr.ext(), endpoint);
+        for (size_t i = 0; i < matches.size(); i++)
         {
-            if (i->address().ext() == addr.ext())
+            LightNode *lightNode = &nodes[matches[i]];
+            if (lightNode->address().ext() == addr.ext())
             {
-                if ((endpoint == 0) || (endpoint == i->haEndpoint().endpoint()))
+                if ((endpoint == 0) || (endpoint == lightNode->haEndpoint().endpoint()))
                 {
-                    return &(*i);
+                    return lightNode;
                 }
             }
         }
     }
     else if (addr.hasNwk())
     {
-        for (; i != end; ++i)
+        const std::vector<size_t> &matches = lightIndex.slotsForNwk(addr.nwk());
+        for (size_t i = 0; i < matches.size(); i++)
         {
-            if (i->address().nwk() == addr.nwk())
+            LightNode *lightNode = &nodes[matches[i]];
+            if (lightNode->address().nwk() == addr.nwk())
             {
-                if ((endpoint == 0) || (endpoint == i->haEndpoint().endpoint()))
+                if ((endpoint == 0) || (endpoint == lightNode->haEndpoint().endpoint()))
                 {
-                    return &(*i);
+                    return lightNode;
                 }
             }
         }
@@ -1643,12 +1751,11 @@ LightNode *DeRestPluginPrivate::getLightNodeForAddress(const deCONZ::Address &ad
 int DeRestPluginPrivate::getNumberOfEndpoints(quint64 extAddr)
 {
     int count = 0;
-    std::vector<LightNode>::iterator i;
-    std::vector<LightNode>::iterator end = nodes.end();
+    const std::vector<size_t> &matches = lightIndex.slotsForExt(extAddr);
 
-    for (i = nodes.begin(); i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->address().ext() == extAddr)
+        if (nodes[matches[i]].address().ext() == extAddr)
         {
             count++;
         }
@@ -1661,20 +1768,33 @@ int DeRestPluginPrivate::getNumberOfEndpoints(quint64 extAddr)
  */
 LightNode *DeRestPluginPrivate::getLightNodeForId(const QString &id)
 {
-    std::vector<LightNode>::iterator i;
-    std::vector<LightNode>::iterator end = nodes.end();
+    const std::vector<size_t> &matches = lightIndex.slotsForId(id);
 
-    for (i = nodes.begin(); i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->id() == id)
+        if (nodes[matches[i]].id() == id)
         {
-            return &(*i);
+            return &nodes[matches[i]];
         }
     }
 
     return 0;
 }
 
+/*! Refreshes the lookup index entries of \p lightNode.
+    Must be called after a LightNode was added or its address, id or unique id changed.
+ */
+void DeRestPluginPrivate::indexLightNode(const LightNode *lightNode)
+{
+    DBG_Assert(lightNode != 0);
+    size_t slot;
+    if (lightNode && nodes.slotOf(lightNode, &slot))
+    {
+        lightIndex.update(slot, *lightNode, lightNode->haEndpoint().endpoint());
+        indexLightGroups(lightNode);
+    }
+}
+
 /*! Returns a Rule for its given \p id or 0 if not found.
  */
 Rule *DeRestPluginPrivate::getRuleForId(const QString &id)
@@ -2045,8 +2165,8 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node)
     Q_Q(DeRestPlugin);
 
     { // check existing sensors
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlotMap<Sensor>::iterator i = sensors.begin();
+        SlotMap<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -2074,6 +2194,7 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node)
                 if (i->address().nwk() != node->address().nwk())
                 {
                     i->address() = node->address();
+                    indexSensorNode(&*i);
                 }
             }
         }
@@ -2393,8 +2514,8 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node, const SensorFi
     if (node->endpoints().size() == 1)
     {
         quint8 ep = node->endpoints()[0];
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlotMap<Sensor>::iterator i = sensors.begin();
+        SlotMap<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -2650,6 +2771,7 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node, const SensorFi
     {
         DBG_Printf(DBG_INFO, "SensorNode %s: %s added\n", qPrintable(sensorNode.id()), qPrintable(sensorNode.name()));
         sensors.push_back(sensorNode);
+        indexSensorNode(&sensors.back());
         updateSensorEtag(&sensors.back());
     }
 
@@ -2684,8 +2806,8 @@ void DeRestPluginPrivate::checkUpdatedFingerPrint(const deCONZ::Node *node, quin
         return;
     }
 
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlotMap<Sensor>::iterator i = sensors.begin();
+    SlotMap<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -2745,6 +2867,7 @@ void DeRestPluginPrivate::checkUpdatedFingerPrint(const deCONZ::Node *node, quin
 
             updateSensorEtag(&*i);
             i->setUniqueId(generateUniqueId(i->address().ext(), fp.endpoint, clusterId));
+            indexSensorNode(&*i);
             i->setNeedSaveDatabase(true);
             queSaveDb(DB_SENSORS, DB_SHORT_SAVE_DELAY);
         }
@@ -2766,8 +2889,8 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
 
     bool updated = false;
 
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlotMap<Sensor>::iterator i = sensors.begin();
+    SlotMap<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -2798,7 +2921,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
         {
             if (event.node()->powerDescriptor().isValid())
             {
-                ResourceItem *item = i->item(RConfigBattery);
+                ResourceItem *item = i->item(RIdConfigBattery);
                 int battery = 255; // invalid
 
                 if (event.node()->powerDescriptor().currentPowerSource() == deCONZ::PowerSourceRechargeable ||
@@ -2911,7 +3034,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                     i->setZclValue(updateType, event.clusterId(), ia->id(), ia->numericValue());
                                 }
 
-                                ResourceItem *item = i->item(RConfigBattery);
+                                ResourceItem *item = i->item(RIdConfigBattery);
 
                                 // Specifies the remaining battery life as a half integer percentage of the full battery capacity (e.g., 34.5%, 45%,
                                 // 68.5%, 90%) with a range between zero and 100%, with 0x00 = 0%, 0x64 = 50%, and 0xC8 = 100%. This is
@@ -2945,7 +3068,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                     i->setZclValue(updateType, event.clusterId(), 0x0000, ia->numericValue());
                                 }
 
-                                ResourceItem *item = i->item(RStateLightLevel);
+                                ResourceItem *item = i->item(RIdStateLightLevel);
 
                                 quint16 measuredValue = ia->numericValue().u16; // ZigBee uses a 16-bit value
 
@@ -2957,7 +3080,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                     enqueueEvent(e);
                                 }
 
-                                item = i->item(RStateLux);
+                                item = i->item(RIdStateLux);
 
                                 if (!item)
                                 {
@@ -3013,7 +3136,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                 }
 
                                 int temp = ia->numericValue().s16;
-                                ResourceItem *item = i->item(RStateTemperature);
+                                ResourceItem *item = i->item(RIdStateTemperature);
 
                                 if (item)
                                 {
@@ -3039,7 +3162,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                 }
 
                                 int humidity = ia->numericValue().u16;
-                                ResourceItem *item = i->item(RStateHumidity);
+                                ResourceItem *item = i->item(RIdStateHumidity);
 
                                 if (item)
                                 {
@@ -3065,7 +3188,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                 }
 
                                 int pressure = ia->numericValue().u16;
-                                ResourceItem *item = i->item(RStatePressure);
+                                ResourceItem *item = i->item(RIdStatePressure);
 
                                 if (item)
                                 {
@@ -3090,7 +3213,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                     i->setZclValue(updateType, event.clusterId(), 0x0000, ia->numericValue());
                                 }
 
-                                ResourceItem *item = i->item(RStatePresence);
+                                ResourceItem *item = i->item(RIdStatePresence);
 
                                 if (item)
                                 {
@@ -3104,7 +3227,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                             else if (ia->id() == 0x0010) // occupied to unoccupied delay
                             {
                                 quint16 duration = ia->numericValue().u16;
-                                ResourceItem *item = i->item(RConfigDuration);
+                                ResourceItem *item = i->item(RIdConfigDuration);
 
                                 if (!item)
                                 {
@@ -3266,29 +3389,27 @@ bool DeRestPluginPrivate::isDeviceSupported(const deCONZ::Node *node, const QStr
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForAddress(quint64 extAddr)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    const std::vector<size_t> &matches = sensorIndex.slotsForExt(extAddr);
+    Sensor *deleted = 0;
 
-    for (; i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->address().ext() == extAddr && i->deletedState() != Sensor::StateDeleted)
+        Sensor *sensor = &sensors[matches[i]];
+        if (sensor->address().ext() == extAddr)
         {
-            return &(*i);
-        }
-    }
-
-    end = sensors.end();
+            if (sensor->deletedState() != Sensor::StateDeleted)
+            {
+                return sensor;
+            }
 
-    for (i = sensors.begin(); i != end; ++i)
-    {
-        if (i->address().ext() == extAddr)
-        {
-            return &(*i);
+            if (!deleted)
+            {
+                deleted = sensor;
+            }
         }
     }
 
-    return 0;
-
+    return deleted;
 }
 
 /*! Returns the first Sensor for its given \p addr or 0 if not found.
@@ -3296,79 +3417,69 @@ Sensor *DeRestPluginPrivate::getSensorNodeForAddress(quint64 extAddr)
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForAddress(const deCONZ::Address &addr)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    Sensor *deleted = 0;
 
     if (addr.hasExt())
     {
-        for (; i != end; ++i)
-        {
-            if (i->address().ext() == addr.ext() && i->deletedState() != Sensor::StateDeleted)
-            {
-                return &(*i);
-            }
-        }
-
-        for (i = sensors.begin(); i != end; ++i)
-        {
-            if (i->address().ext() == addr.ext())
-            {
-                return &(*i);
-            }
-        }
+        return getSensorNodeForAddress(addr.ext());
     }
     else if (addr.hasNwk())
     {
-        for (; i != end; ++i)
-        {
-            if (i->address().nwk() == addr.nwk() && i->deletedState() != Sensor::StateDeleted)
-            {
-                return &(*i);
-            }
-        }
+        const std::vector<size_t> &matches = sensorIndex.slotsForNwk(addr.nwk());
 
-        for (i = sensors.begin(); i != end; ++i)
+        for (size_t i = 0; i < matches.size(); i++)
         {
-            if (i->address().nwk() == addr.nwk())
+            Sensor *sensor = &sensors[matches[i]];
+            if (sensor->address().nwk() == addr.nwk())
             {
-                return &(*i);
+                if (sensor->deletedState() != Sensor::StateDeleted)
+                {
+                    return sensor;
+                }
+
+                if (!deleted)
+                {
+                    deleted = sensor;
+                }
             }
         }
     }
 
-    return 0;
+    return deleted;
 }
 
 /*! Returns the first Sensor for its given \p Address and \p Endpoint or 0 if not found.
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForAddressAndEndpoint(const deCONZ::Address &addr, quint8 ep)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
-
     if (addr.hasExt())
     {
-        for (; i != end; ++i)
+        const std::vector<size_t> &matches = sensorIndex.slotsForExtAndEndpoint(addr.ext(), ep);
+
+        for (size_t i = 0; i < matches.size(); i++)
         {
-            if (i->address().ext() == addr.ext() && ep == i->fingerPrint().endpoint && i->deletedState() != Sensor::StateDeleted)
+            Sensor *sensor = &sensors[matches[i]];
+            if (sensor->address().ext() == addr.ext() && ep == sensor->fingerPrint().endpoint && sensor->deletedState() != Sensor::StateDeleted)
             {
-                return &(*i);
+                return sensor;
             }
         }
     }
     else if (addr.hasNwk())
     {
-        for (i = sensors.begin(); i != end; ++i)
+        const std::vector<size_t> &matches = sensorIndex.slotsForNwk(addr.nwk());
+
+        for (size_t i = 0; i < matches.size(); i++)
         {
-            if (i->address().nwk() == addr.nwk() && ep == i->fingerPrint().endpoint && i->deletedState() != Sensor::StateDeleted)
+            Sensor *sensor = &sensors[matches[i]];
+            if (sensor->address().nwk() == addr.nwk() && ep == sensor->fingerPrint().endpoint && sensor->deletedState() != Sensor::StateDeleted)
             {
-                return &(*i);
+                return sensor;
             }
         }
     }
 
     return 0;
-
 }
 
 /*! Returns the first Sensor which matches a fingerprint.
@@ -3376,64 +3487,50 @@ Sensor *DeRestPluginPrivate::getSensorNodeForAddressAndEndpoint(const deCONZ::Ad
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForFingerPrint(quint64 extAddr, const SensorFingerprint &fingerPrint, const QString &type)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    const std::vector<size_t> &matches = sensorIndex.slotsForExt(extAddr);
+    Sensor *sensor = 0;
 
-    for (; i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->address().ext() == extAddr && i->deletedState() != Sensor::StateDeleted)
+        Sensor *s = &sensors[matches[i]];
+        if (s->address().ext() == extAddr && s->type() == type && s->fingerPrint().endpoint == fingerPrint.endpoint)
         {
-            if (i->type() == type && i->fingerPrint().endpoint == fingerPrint.endpoint)
+            if (s->deletedState() != Sensor::StateDeleted)
             {
-                if (!(i->fingerPrint() == fingerPrint))
-                {
-                    DBG_Printf(DBG_INFO, "updated fingerprint for sensor %s\n", qPrintable(i->name()));
-                    i->fingerPrint() = fingerPrint;
-                    i->setNeedSaveDatabase(true);
-                    updateEtag(i->etag);
-                    queSaveDb(DB_SENSORS , DB_SHORT_SAVE_DELAY);
-                }
-                return &(*i);
+                sensor = s;
+                break;
             }
-        }
-    }
-
-    end = sensors.end();
 
-    for (i = sensors.begin(); i != end; ++i)
-    {
-        if (i->address().ext() == extAddr)
-        {
-            if (i->type() == type && i->fingerPrint().endpoint == fingerPrint.endpoint)
+            if (!sensor)
             {
-                if (!(i->fingerPrint() == fingerPrint))
-                {
-                    DBG_Printf(DBG_INFO, "updated fingerprint for sensor %s\n", qPrintable(i->name()));
-                    i->fingerPrint() = fingerPrint;
-                    i->setNeedSaveDatabase(true);
-                    updateEtag(i->etag);
-                    queSaveDb(DB_SENSORS , DB_SHORT_SAVE_DELAY);
-                }
-                return &(*i);
+                sensor = s; // deleted sensors are only used if no other one matches
             }
         }
     }
 
-    return 0;
+    if (sensor && !(sensor->fingerPrint() == fingerPrint))
+    {
+        DBG_Printf(DBG_INFO, "updated fingerprint for sensor %s\n", qPrintable(sensor->name()));
+        sensor->fingerPrint() = fingerPrint;
+        sensor->setNeedSaveDatabase(true);
+        updateSensorEtag(sensor);
+        queSaveDb(DB_SENSORS , DB_SHORT_SAVE_DELAY);
+    }
+
+    return sensor;
 }
 
 /*! Returns a Sensor for its given \p unique id or 0 if not found.
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForUniqueId(const QString &uniqueId)
 {
-    std::vector<Sensor>::iterator i;
-    std::vector<Sensor>::iterator end = sensors.end();
+    const std::vector<size_t> &matches = sensorIndex.slotsForUniqueId(uniqueId);
 
-    for (i = sensors.begin(); i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->uniqueId() == uniqueId)
+        if (sensors[matches[i]].uniqueId() == uniqueId)
         {
-            return &(*i);
+            return &sensors[matches[i]];
         }
     }
 
@@ -3444,20 +3541,32 @@ Sensor *DeRestPluginPrivate::getSensorNodeForUniqueId(const QString &uniqueId)
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForId(const QString &id)
 {
-    std::vector<Sensor>::iterator i;
-    std::vector<Sensor>::iterator end = sensors.end();
+    const std::vector<size_t> &matches = sensorIndex.slotsForId(id);
 
-    for (i = sensors.begin(); i != end; ++i)
+    for (size_t i = 0; i < matches.size(); i++)
     {
-        if (i->id() == id)
+        if (sensors[matches[i]].id() == id)
         {
-            return &(*i);
+            return &sensors[matches[i]];
         }
     }
 
     return 0;
 }
 
+/*! Refreshes the lookup index entries of \p sensor.
+    Must be called after a Sensor was added or its address, id or unique id changed.
+ */
+void DeRestPluginPrivate::indexSensorNode(const Sensor *sensor)
+{
+    DBG_Assert(sensor != 0);
+    size_t slot;
+    if (sensor && sensors.slotOf(sensor, &slot))
+    {
+        sensorIndex.update(slot, *sensor, sensor->fingerPrint().endpoint);
+    }
+}
+
 /*! Returns a Group for a given group id or 0 if not found.
  */
 Group *DeRestPluginPrivate::getGroupForId(uint16_t id)
@@ -3588,6 +3697,7 @@ bool DeRestPluginPrivate::deleteOldGroupOfSwitch(Sensor *sensor, quint16 newGrou
             DBG_Printf(DBG_INFO, "delete old switch group 0x%04X of sensor %s\n", i->address(), qPrintable(sensor->name()));
             //found
             i->setState(Group::StateDeleted);
+            updateGroupEtag(&*i);
         }
     }
     return true;
@@ -3644,8 +3754,8 @@ void DeRestPluginPrivate::changeRuleStatusofGroup(QString groupId, bool enabled)
         // detect sensor of that rule
         QString sensorModelId = "";
         QString sensorType = "";
-        std::vector<Sensor>::iterator si = sensors.begin();
-        std::vector<Sensor>::iterator send = sensors.end();
+        SlotMap<Sensor>::iterator si = sensors.begin();
+        SlotMap<Sensor>::iterator send = sensors.end();
         for (; si != send; ++si)
         {
             if (si->id() == sensorId)
@@ -3698,6 +3808,7 @@ GroupInfo *DeRestPluginPrivate::createGroupInfo(LightNode *lightNode, uint16_t i
     GroupInfo groupInfo;
     groupInfo.id = id;
     lightNode->groups().push_back(groupInfo);
+    indexLightGroups(lightNode);
 
     return &lightNode->groups().back();
 }
@@ -3869,8 +3980,8 @@ bool DeRestPluginPrivate::processZclAttributes(LightNode *lightNode)
         if (readBindingTable(lightNode, 0))
         {
             // only read binding table once per node even if multiple devices/sensors are implemented
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlotMap<LightNode>::iterator i = nodes.begin();
+            SlotMap<LightNode>::iterator end = nodes.end();
 
             for (; i != end; ++i)
             {
@@ -4138,8 +4249,8 @@ bool DeRestPluginPrivate::processZclAttributes(Sensor *sensorNode)
         if (ok && readBindingTable(sensorNode, 0))
         {
             // only read binding table once per node even if multiple devices/sensors are implemented
-            std::vector<Sensor>::iterator i = sensors.begin();
-            std::vector<Sensor>::iterator end = sensors.end();
+            SlotMap<Sensor>::iterator i = sensors.begin();
+            SlotMap<Sensor>::iterator end = sensors.end();
 
             for (; i != end; ++i)
             {
@@ -4227,6 +4338,9 @@ bool DeRestPluginPrivate::processZclAttributes(Sensor *sensorNode)
 }
 
 /*! Queue reading ZCL attributes of a node.
+
+    Reads of the same node, endpoint and cluster which are queued within READ_BATCH_WINDOW ms
+    are sent as one Read Attributes frame.
     \param restNode the node from which the attributes shall be read
     \param endpoint the destination endpoint
     \param clusterId the cluster id related to the attributes
@@ -4243,56 +4357,162 @@ bool DeRestPluginPrivate::readAttributes(RestNodeBase *restNode, quint8 endpoint
         return false;
     }
 
-    if (taskCountForAddress(restNode->address()) > 0)
+    std::vector<ReadAttributesBatch>::iterator b = readBatches.begin();
+    std::vector<ReadAttributesBatch>::iterator bend = readBatches.end();
+
+    for (; b != bend; ++b)
     {
-        return false;
+        if (b->address.ext() == restNode->address().ext() && b->endpoint == endpoint && b->clusterId == clusterId)
+        {
+            break;
+        }
     }
 
-    TaskItem task;
-    task.taskType = TaskReadAttributes;
-
-//    task.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
-    task.req.setDstEndpoint(endpoint);
-    task.req.setDstAddressMode(deCONZ::ApsExtAddress);
-    task.req.dstAddress() = restNode->address();
-    task.req.setClusterId(clusterId);
-    task.req.setProfileId(HA_PROFILE_ID);
-    task.req.setSrcEndpoint(getSrcEndpoint(restNode, task.req));
-
-    task.zclFrame.setSequenceNumber(zclSeq++);
-    task.zclFrame.setCommandId(deCONZ::ZclReadAttributesId);
-    task.zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
-                             deCONZ::ZclFCDirectionClientToServer |
-                             deCONZ::ZclFCDisableDefaultResponse);
+    if (b == bend)
+    {
+        // one request per node at a time, batches of other clusters count as queued requests
+        int pending = taskCountForAddress(restNode->address());
+        for (b = readBatches.begin(); b != bend && pending == 0; ++b)
+        {
+            if (b->address.ext() == restNode->address().ext())
+            {
+                pending++;
+            }
+        }
 
-    DBG_Printf(DBG_INFO_L2, "read attributes of 0x%016llX cluster: 0x%04X: [ ", restNode->address().ext(), clusterId);
+        if (pending > 0)
+        {
+            return false;
+        }
 
-    { // payload
-        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+        ReadAttributesBatch batch;
+        batch.address = restNode->address();
+        batch.endpoint = endpoint;
+        batch.clusterId = clusterId;
+        batch.due = steadyTimeRef().addMSecs(READ_BATCH_WINDOW);
+        readBatches.push_back(batch);
+        b = readBatches.end() - 1;
 
-        for (uint i = 0; i < attributes.size(); i++)
+        if (!readBatchTimer->isActive())
         {
-            stream << attributes[i];
-            if (DBG_IsEnabled(DBG_INFO_L2))
-            {
-                DBG_Printf(DBG_INFO_L2, "0x%04X ", attributes[i]);
-            }
+            readBatchTimer->start(READ_BATCH_WINDOW);
         }
     }
 
-    if (DBG_IsEnabled(DBG_INFO_L2))
+    for (size_t i = 0; i < attributes.size(); i++)
     {
-        DBG_Printf(DBG_INFO_L2, "]\n");
-    }
-
-    { // ZCL frame
-        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        task.zclFrame.writeToStream(stream);
+        if (std::find(b->attributes.begin(), b->attributes.end(), attributes[i]) == b->attributes.end())
+        {
+            b->attributes.push_back(attributes[i]);
+        }
     }
 
-    return addTask(task);
+    return true;
+}
+
+/*! Sends the collected attribute reads which are due.
+    The callers already cleared their read flags, so a batch which can't be queued
+    is kept and tried again later.
+ */
+void DeRestPluginPrivate::flushReadBatches()
+{
+    const SteadyTimeRef now = steadyTimeRef();
+    std::vector<ReadAttributesBatch>::iterator b = readBatches.begin();
+
+    while (b != readBatches.end())
+    {
+        if (b->due > now)
+        {
+            ++b;
+            continue;
+        }
+
+        size_t first = 0;
+        for (; first < b->attributes.size(); first += READ_ATTRIBUTES_MAX)
+        {
+            if (!sendReadAttributes(*b, first, qMin(b->attributes.size() - first, (size_t)READ_ATTRIBUTES_MAX)))
+            {
+                break;
+            }
+        }
+
+        if (first < b->attributes.size() && b->retries < READ_BATCH_MAX_RETRIES)
+        {
+            // keep the attributes which weren't queued
+            b->attributes.erase(b->attributes.begin(), b->attributes.begin() + first);
+            b->retries++;
+            b->due = now.addMSecs(READ_BATCH_RETRY_DELAY);
+            ++b;
+            continue;
+        }
+
+        if (first < b->attributes.size())
+        {
+            DBG_Printf(DBG_INFO, "drop read attributes of 0x%016llX cluster: 0x%04X after %d attempts\n", b->address.ext(), b->clusterId, b->retries + 1);
+        }
+
+        b = readBatches.erase(b);
+    }
+
+    if (!readBatches.empty())
+    {
+        readBatchTimer->start(READ_BATCH_WINDOW);
+    }
+}
+
+/*! Queues a Read Attributes request for a part of a batch.
+    \param batch the collected attribute reads
+    \param first index of the first attribute id
+    \param count number of attribute ids
+    \return true if the request is queued
+ */
+bool DeRestPluginPrivate::sendReadAttributes(const ReadAttributesBatch &batch, size_t first, size_t count)
+{
+    TaskItem task;
+    task.taskType = TaskReadAttributes;
+
+//    task.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+    task.req.setDstEndpoint(batch.endpoint);
+    task.req.setDstAddressMode(deCONZ::ApsExtAddress);
+    task.req.dstAddress() = batch.address;
+    task.req.setClusterId(batch.clusterId);
+    task.req.setProfileId(HA_PROFILE_ID);
+    task.req.setSrcEndpoint(getSrcEndpoint(0, task.req));
+
+    task.zclFrame.setSequenceNumber(zclSeq++);
+    task.zclFrame.setCommandId(deCONZ::ZclReadAttributesId);
+    task.zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                             deCONZ::ZclFCDirectionClientToServer |
+                             deCONZ::ZclFCDisableDefaultResponse);
+
+    DBG_Printf(DBG_INFO_L2, "read attributes of 0x%016llX cluster: 0x%04X: [ ", batch.address.ext(), batch.clusterId);
+
+    { // payload
+        QDataStream stream(&task.zclFrame.payload(), QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+
+        for (size_t i = first; i < first + count; i++)
+        {
+            stream << batch.attributes[i];
+            if (DBG_IsEnabled(DBG_INFO_L2))
+            {
+                DBG_Printf(DBG_INFO_L2, "0x%04X ", batch.attributes[i]);
+            }
+        }
+    }
+
+    if (DBG_IsEnabled(DBG_INFO_L2))
+    {
+        DBG_Printf(DBG_INFO_L2, "]\n");
+    }
+
+    { // ZCL frame
+        QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        task.zclFrame.writeToStream(stream);
+    }
+
+    return addTask(task);
 }
 
 /*! Queue reading Group Identifiers.
@@ -4532,6 +4752,7 @@ void DeRestPluginPrivate::foundGroupMembership(LightNode *lightNode, uint16_t gr
                     i->state = GroupInfo::StateNotInGroup;
                     lightNode->setNeedSaveDatabase(true);
                     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
+                    indexLightGroups(lightNode);
                 }
             }
 
@@ -4563,6 +4784,7 @@ void DeRestPluginPrivate::foundGroupMembership(LightNode *lightNode, uint16_t gr
     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
     lightNode->setNeedSaveDatabase(true);
     lightNode->groups().push_back(groupInfo);
+    indexLightGroups(lightNode);
 }
 
 /*! Checks if the group is known in the global cache.
@@ -4592,7 +4814,7 @@ void DeRestPluginPrivate::foundGroup(uint16_t groupId)
     group.hueReal = 0.0f;
     group.sat = 128;
     group.setName(QString());
-    updateEtag(group.etag);
+    updateGroupEtag(&group);
     openDb();
     loadGroupFromDb(&group);
     closeDb();
@@ -4631,6 +4853,57 @@ bool DeRestPluginPrivate::isLightNodeInGroup(const LightNode *lightNode, uint16_
     return false;
 }
 
+/*! Collects all lights which are member of the group with the \p groupId.
+    The global group 0 contains all lights.
+    \param groupId - the group address
+    \param lightNodes - receives the member lights in container order
+ */
+void DeRestPluginPrivate::getLightNodesInGroup(uint16_t groupId, std::vector<LightNode*> &lightNodes)
+{
+    lightNodes.clear();
+
+    if (groupId == 0)
+    {
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
+
+        for (; i != end; ++i)
+        {
+            lightNodes.push_back(&*i);
+        }
+        return;
+    }
+
+    const std::vector<size_t> &members = groupIndex.members(groupId);
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        if (members[i] < nodes.size())
+        {
+            lightNodes.push_back(&nodes[members[i]]);
+        }
+    }
+}
+
+/*! Refreshes the group memberships and on/reachable state of \p lightNode in the group index.
+    Must be called after GroupInfo::state, state/on or state/reachable of the light changed.
+    Groups which the light joined or left get a new version, since their lights list changed.
+ */
+void DeRestPluginPrivate::indexLightGroups(const LightNode *lightNode)
+{
+    DBG_Assert(lightNode != 0);
+    size_t slot;
+    if (lightNode && nodes.slotOf(lightNode, &slot))
+    {
+        std::vector<quint16> changedGroups;
+        groupIndex.update(slot, *lightNode, &changedGroups);
+
+        for (size_t i = 0; i < changedGroups.size(); i++)
+        {
+            updateGroupEtag(getGroupForId(changedGroups[i]));
+        }
+    }
+}
+
 /*! Delete the light with the \p lightId from all Scenes of the Group with the given \p groupId.
     Also remove these scenes from the Device.
  */
@@ -4677,8 +4950,8 @@ void DeRestPluginPrivate::readAllInGroup(Group *group)
     }
 
     QTime t = QTime::currentTime().addMSecs(ReadAttributesLongerDelay);
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -4732,24 +5005,23 @@ void DeRestPluginPrivate::setAttributeOnOffGroup(Group *group, uint8_t onOff)
         changed = true;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    std::vector<LightNode*> lightNodes;
+    getLightNodesInGroup(group->address(), lightNodes);
+    std::vector<LightNode*>::iterator i = lightNodes.begin();
+    std::vector<LightNode*>::iterator end = lightNodes.end();
 
     for (; i != end; ++i)
     {
-        LightNode *lightNode = &*i;
-        if (isLightNodeInGroup(lightNode, group->address()))
+        LightNode *lightNode = *i;
+        ResourceItem *item = lightNode->item(RStateOn);
+        if (item->toBool() != on)
         {
-            ResourceItem *item = lightNode->item(RStateOn);
-            if (item->toBool() != on)
-            {
-                item->setValue(on);
-                Event e(RLights, RStateOn, lightNode->id());
-                enqueueEvent(e);
-                updateLightEtag(lightNode);
-            }
-            setAttributeOnOff(lightNode);
+            item->setValue(on);
+            Event e(RLights, RStateOn, lightNode->id());
+            enqueueEvent(e);
+            updateLightEtag(lightNode);
         }
+        setAttributeOnOff(lightNode);
     }
 
     if (changed)
@@ -4853,7 +5125,7 @@ void DeRestPluginPrivate::foundScene(LightNode *lightNode, Group *group, uint8_t
         scene.name.sprintf("Scene %u", sceneId);
     }
     group->scenes.push_back(scene);
-    updateEtag(group->etag);
+    updateGroupEtag(group);
     updateEtag(gwConfigEtag);
     queSaveDb(DB_SCENES, DB_SHORT_SAVE_DELAY);
 }
@@ -4879,7 +5151,7 @@ void DeRestPluginPrivate::setSceneName(Group *group, uint8_t sceneId, const QStr
         {
             i->name = name;
             queSaveDb(DB_SCENES, DB_SHORT_SAVE_DELAY);
-            updateEtag(group->etag);
+            updateGroupEtag(group);
             break;
         }
     }
@@ -4903,8 +5175,8 @@ bool DeRestPluginPrivate::storeScene(Group *group, uint8_t sceneId)
     task.req.setSrcEndpoint(0x01);
     addTaskStoreScene(task, group->address(), sceneId);
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -4956,8 +5228,8 @@ bool DeRestPluginPrivate::modifyScene(Group *group, uint8_t sceneId)
         return false;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -4999,15 +5271,15 @@ bool DeRestPluginPrivate::removeScene(Group *group, uint8_t sceneId)
             if (i->id == sceneId)
             {
                 i->state = Scene::StateDeleted;
-                updateEtag(group->etag);
+                updateGroupEtag(group);
                 updateEtag(gwConfigEtag);
                 break;
             }
         }
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -5100,6 +5372,39 @@ void DeRestPluginPrivate::handleDEClusterIndication(const deCONZ::ApsDataIndicat
     }
 }
 
+/*! Returns the size of a value of the ZCL data type \p type,
+    or -1 for strings and unknown types.
+ */
+static int zclDataTypeSize(quint8 type)
+{
+    if (type >= 0x08 && type <= 0x0f) { return type - 0x07; } // data8 .. data64
+    if (type == 0x10) { return 1; } // boolean
+    if (type >= 0x18 && type <= 0x1f) { return type - 0x17; } // bitmap8 .. bitmap64
+    if (type >= 0x20 && type <= 0x27) { return type - 0x1f; } // uint8 .. uint64
+    if (type >= 0x28 && type <= 0x2f) { return type - 0x27; } // int8 .. int64
+
+    switch (type)
+    {
+    case 0x30: return 1; // enum8
+    case 0x31: return 2; // enum16
+    case 0x38: return 2; // semi precision
+    case 0x39: return 4; // single precision
+    case 0x3a: return 8; // double precision
+    case 0xe0: return 4; // time of day
+    case 0xe1: return 4; // date
+    case 0xe2: return 4; // UTC time
+    case 0xe8: return 2; // cluster id
+    case 0xe9: return 2; // attribute id
+    case 0xea: return 4; // BACnet OID
+    case 0xf0: return 8; // IEEE address
+    case 0xf1: return 16; // security key
+    default:
+        break;
+    }
+
+    return -1;
+}
+
 /*! Handle incoming ZCL attribute report commands.
  */
 void DeRestPluginPrivate::handleZclAttributeReportIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame)
@@ -5111,6 +5416,58 @@ void DeRestPluginPrivate::handleZclAttributeReportIndication(const deCONZ::ApsDa
         sendZclDefaultResponse(ind, zclFrame, deCONZ::ZclSuccessStatus);
     }
 
+    {
+        const LightNode *lightNode = getLightNodeForAddress(ind.srcAddress(), ind.srcEndpoint());
+
+        if (lightNode)
+        {
+            QDataStream stream(zclFrame.payload());
+            stream.setByteOrder(QDataStream::LittleEndian);
+
+            // attribute records: id, data type, value
+            while (!stream.atEnd())
+            {
+                quint16 attrId;
+                quint8 dataType;
+                stream >> attrId;
+                stream >> dataType;
+
+                if (stream.status() != QDataStream::Ok)
+                {
+                    break;
+                }
+
+                pollReportReceived(lightNode, ind.clusterId(), attrId);
+
+                int size = zclDataTypeSize(dataType);
+                if (size < 0) // strings have a length prefix
+                {
+                    if (dataType == 0x41 || dataType == 0x42) // octet and character string
+                    {
+                        quint8 len;
+                        stream >> len;
+                        size = len;
+                    }
+                    else if (dataType == 0x43 || dataType == 0x44) // long octet and character string
+                    {
+                        quint16 len;
+                        stream >> len;
+                        size = len;
+                    }
+                    else
+                    {
+                        break; // unknown size
+                    }
+                }
+
+                if (stream.skipRawData(size) != size)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
     if (otauLastBusyTimeDelta() < (60 * 60))
     {
         if ((idleTotalCounter - otauUnbindIdleTotalCounter) > 5)
@@ -5413,235 +5770,6 @@ void DeRestPluginPrivate::pushClientForClose(QTcpSocket *sock, int closeTimeout,
     openClients.push_back(client);
 }
 
-/*! Adds a task to the queue.
-    \return true - on success
- */
-bool DeRestPluginPrivate::addTask(const TaskItem &task)
-{
-    if (!isInNetwork())
-    {
-        return false;
-    }
-
-    const uint MaxTasks = 20;
-
-    std::list<TaskItem>::iterator i = tasks.begin();
-    std::list<TaskItem>::iterator end = tasks.end();
-
-    if ((task.taskType != TaskGetSceneMembership) &&
-        (task.taskType != TaskGetGroupMembership) &&
-        (task.taskType != TaskGetGroupIdentifiers) &&
-        (task.taskType != TaskStoreScene) &&
-        (task.taskType != TaskRemoveScene) &&
-        (task.taskType != TaskRemoveAllScenes) &&
-        (task.taskType != TaskReadAttributes) &&
-        (task.taskType != TaskWriteAttribute) &&
-        (task.taskType != TaskViewScene) &&
-        (task.taskType != TaskAddScene))
-    {
-        for (; i != end; ++i)
-        {
-            if (i->taskType == task.taskType)
-            {
-                if ((i->req.dstAddress() ==  task.req.dstAddress()) &&
-                    (i->req.dstEndpoint() ==  task.req.dstEndpoint()) &&
-                    (i->req.srcEndpoint() ==  task.req.srcEndpoint()) &&
-                    (i->req.profileId() ==  task.req.profileId()) &&
-                    (i->req.clusterId() ==  task.req.clusterId()) &&
-                    (i->req.txOptions() ==  task.req.txOptions()) &&
-                    (i->req.asdu().size() ==  task.req.asdu().size()))
-
-                {
-                    DBG_Printf(DBG_INFO, "Replace task in queue cluster 0x%04X with newer task of same type. %u runnig tasks\n", task.req.clusterId(), runningTasks.size());
-                    *i = task;
-                    return true;
-                }
-            }
-        }
-    }
-
-    if (tasks.size() < MaxTasks) {
-        tasks.push_back(task);
-        return true;
-    }
-
-    return false;
-}
-
-/*! Fires the next APS-DATA.request.
- */
-void DeRestPluginPrivate::processTasks()
-{
-    if (!apsCtrl)
-    {
-        return;
-    }
-
-    if (tasks.empty())
-    {
-        return;
-    }
-
-    if (!isInNetwork())
-    {
-        DBG_Printf(DBG_INFO, "Not in network cleanup %d tasks\n", (runningTasks.size() + tasks.size()));
-        runningTasks.clear();
-        tasks.clear();
-        return;
-    }
-
-    if (runningTasks.size() > 4)
-    {
-        std::list<TaskItem>::iterator j = runningTasks.begin();
-        std::list<TaskItem>::iterator jend = runningTasks.end();
-
-        for (; j != jend; ++j)
-        {
-            int dt = idleTotalCounter - j->sendTime;
-
-            if (dt > 120)
-            {
-                DBG_Printf(DBG_INFO, "drop request %u send time %d, cluster 0x%04X, after %d seconds\n", j->req.id(), j->sendTime, j->req.clusterId(), dt);
-                runningTasks.erase(j);
-                return;
-            }
-
-        }
-
-        DBG_Printf(DBG_INFO, "%d running tasks, wait\n", runningTasks.size());
-        return;
-    }
-
-    QTime now = QTime::currentTime();
-    std::list<TaskItem>::iterator i = tasks.begin();
-    std::list<TaskItem>::iterator end = tasks.end();
-
-    for (; i != end; ++i)
-    {
-        // drop dead unicasts
-        if (i->lightNode && !i->lightNode->isAvailable())
-        {
-            DBG_Printf(DBG_INFO, "drop request to zombie\n");
-            tasks.erase(i);
-            return;
-        }
-
-        // send only few requests to a destination at a time
-        int onAir = 0;
-        const int maxOnAir = 2;
-        std::list<TaskItem>::iterator j = runningTasks.begin();
-        std::list<TaskItem>::iterator jend = runningTasks.end();
-
-        bool ok = true;
-        for (; j != jend; ++j)
-        {
-            if (i->req.dstAddress() == j->req.dstAddress())
-            {
-                onAir++;
-                int dt = idleTotalCounter - j->sendTime;
-                if (dt < 5 || onAir >= maxOnAir)
-                {
-                    if (dt > 120)
-                    {
-                        DBG_Printf(DBG_INFO, "drop request %u send time %d, cluster 0x%04X, onAir %d after %d seconds\n", j->req.id(), j->sendTime, j->req.clusterId(), onAir, dt);
-                        runningTasks.erase(j);
-                        return;
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_INFO_L2, "request %u send time %d, cluster 0x%04X, onAir %d\n", i->req.id(), j->sendTime, j->req.clusterId(), onAir);
-                        DBG_Printf(DBG_INFO_L2, "delay sending request %u dt %d ms to %s\n", i->req.id(), dt, qPrintable(i->req.dstAddress().toStringExt()));
-                        ok = false;
-                    }
-                    break;
-                }
-            }
-        }
-
-        if (!ok) // destination already busy
-        {
-            if (i->req.dstAddressMode() == deCONZ::ApsExtAddress)
-            {
-                DBG_Printf(DBG_INFO_L2, "delay sending request %u cluster 0x%04X to %s\n", i->req.id(), i->req.clusterId(), qPrintable(i->req.dstAddress().toStringExt()));
-            }
-            else if (i->req.dstAddressMode() == deCONZ::ApsGroupAddress)
-            {
-                DBG_Printf(DBG_INFO, "delay sending request %u to group 0x%04X\n", i->req.id(), i->req.dstAddress().group());
-            }
-        }
-        else
-        {
-            bool pushRunning = (i->req.state() != deCONZ::FireAndForgetState);
-
-            // groupcast tasks
-            if (i->req.dstAddressMode() == deCONZ::ApsGroupAddress)
-            {
-                Group *group = getGroupForId(i->req.dstAddress().group());
-
-                if (group)
-                {
-                    int diff = group->sendTime.msecsTo(now);
-
-                    if (!group->sendTime.isValid() || (diff <= 0) || (diff > gwGroupSendDelay))
-                    {
-                        i->sendTime = idleTotalCounter;
-                        if (apsCtrl->apsdeDataRequest(i->req) == deCONZ::Success)
-                        {
-                            group->sendTime = now;
-                            if (pushRunning)
-                            {
-                                runningTasks.push_back(*i);
-                            }
-                            tasks.erase(i);
-                            return;
-                        }
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_INFO, "delayed group sending\n");
-                    }
-                }
-            }
-            // unicast/broadcast tasks
-            else
-            {
-                if (i->lightNode && !i->lightNode->isAvailable())
-                {
-                    DBG_Printf(DBG_INFO, "drop request to zombie\n");
-                    tasks.erase(i);
-                    return;
-                }
-                else
-                {
-
-                    i->sendTime = idleTotalCounter;
-                    int ret = apsCtrl->apsdeDataRequest(i->req);
-
-                    if (ret == deCONZ::Success)
-                    {
-                        if (pushRunning)
-                        {
-                            runningTasks.push_back(*i);
-                        }
-                        tasks.erase(i);
-                        return;
-                    }
-                    else if (ret == deCONZ::ErrorNodeIsZombie)
-                    {
-                        DBG_Printf(DBG_INFO, "drop request to zombie\n");
-                        tasks.erase(i);
-                        return;
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_INFO, "enqueue APS request failed with error %d\n", ret);
-                    }
-                }
-            }
-        }
-    }
-}
-
 /*! Handler for node events.
     \param event the event which occured
  */
@@ -5665,8 +5793,8 @@ void DeRestPluginPrivate::nodeEvent(const deCONZ::NodeEvent &event)
 
     case deCONZ::NodeEvent::NodeRemoved:
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -5981,7 +6109,7 @@ void DeRestPluginPrivate::handleGroupClusterIndication(TaskItem &task, const deC
                     i->actions &= ~GroupInfo::ActionRemoveFromGroup; // sanity
                     i->actions |= GroupInfo::ActionAddToGroup;
                     i->state = GroupInfo::StateInGroup;
-                    updateEtag(group->etag);
+                    updateGroupEtag(group);
                     updateEtag(gwConfigEtag);
                     lightNode->setNeedSaveDatabase(true);
                     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
@@ -6000,7 +6128,7 @@ void DeRestPluginPrivate::handleGroupClusterIndication(TaskItem &task, const deC
                         group->m_multiDeviceIds.erase(fi);
                         queSaveDb(DB_GROUPS, DB_SHORT_SAVE_DELAY);
                     }
-                    updateEtag(group->etag);
+                    updateGroupEtag(group);
                     updateEtag(gwConfigEtag);
                     lightNode->setNeedSaveDatabase(true);
                     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
@@ -6009,13 +6137,15 @@ void DeRestPluginPrivate::handleGroupClusterIndication(TaskItem &task, const deC
                     && i->state == GroupInfo::StateInGroup) // light was removed from group by switch -> remove it from deCONZ group)
                 {
                     i->state = GroupInfo::StateNotInGroup;
-                    updateEtag(group->etag);
+                    updateGroupEtag(group);
                     updateEtag(gwConfigEtag);
                     lightNode->setNeedSaveDatabase(true);
                     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
                 }
             }
         }
+
+        indexLightGroups(lightNode);
     }
     else if (zclFrame.commandId() == 0x00) // Add group response
     {
@@ -6796,7 +6926,7 @@ void DeRestPluginPrivate::handleSceneClusterIndication(TaskItem &task, const deC
         map["r"] = QLatin1String("scenes");
         map["gid"] = QString::number(groupId);
         map["scid"] = QString::number(sceneId);
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("groups"), QString::number(groupId));
 
         // check if scene exists
 
@@ -7027,60 +7157,60 @@ void DeRestPluginPrivate::handleOnOffClusterIndication(TaskItem &task, const deC
                 group->setColorLoopActive(false);
             }
         }
-        updateEtag(group->etag);
+        updateGroupEtag(group);
 
         // check each light if colorloop needs to be disabled
-        std::vector<LightNode>::iterator l = nodes.begin();
-        std::vector<LightNode>::iterator lend = nodes.end();
+        std::vector<LightNode*> lightNodes;
+        getLightNodesInGroup(group->address(), lightNodes);
+        std::vector<LightNode*>::iterator li = lightNodes.begin();
+        std::vector<LightNode*>::iterator lend = lightNodes.end();
 
-        for (; l != lend; ++l)
+        for (; li != lend; ++li)
         {
-            if (isLightNodeInGroup(&*l, group->address()))
+            LightNode *l = *li;
+            bool updated = false;
+            if (zclFrame.commandId() == 0x00 || zclFrame.commandId() == 0x40) // Off || Off with effect
             {
-                bool updated = false;
-                if (zclFrame.commandId() == 0x00 || zclFrame.commandId() == 0x40) // Off || Off with effect
+                ResourceItem *item = l->item(RStateOn);
+                if (item && item->toBool())
                 {
-                    ResourceItem *item = l->item(RStateOn);
-                    if (item && item->toBool())
-                    {
-                        item->setValue(false);
-                        Event e(RLights, RStateOn, l->id());
-                        enqueueEvent(e);
-                        updated = true;
-                    }
+                    item->setValue(false);
+                    Event e(RLights, RStateOn, l->id());
+                    enqueueEvent(e);
+                    updated = true;
                 }
-                else if (zclFrame.commandId() == 0x01 || zclFrame.commandId() == 0x42) // On || On with timed off
+            }
+            else if (zclFrame.commandId() == 0x01 || zclFrame.commandId() == 0x42) // On || On with timed off
+            {
+                ResourceItem *item = l->item(RStateOn);
+                if (item && !item->toBool())
                 {
-                    ResourceItem *item = l->item(RStateOn);
-                    if (item && !item->toBool())
-                    {
-                        item->setValue(true);
-                        Event e(RLights, RStateOn, l->id());
-                        enqueueEvent(e);
-                        updated = true;
-                    }
-
-                    if (l->isAvailable() && l->hasColor() && l->state() != LightNode::StateDeleted && l->isColorLoopActive())
-                    {
-                        TaskItem task2;
-                        task2.lightNode = &(*l);
-                        task2.req.dstAddress() = task2.lightNode->address();
-                        task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
-                        task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
-                        task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
-                        task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
-
-                        addTaskSetColorLoop(task2, false, 15);
-                        l->setColorLoopActive(false);
-                        updated = true;
-                    }
+                    item->setValue(true);
+                    Event e(RLights, RStateOn, l->id());
+                    enqueueEvent(e);
+                    updated = true;
                 }
 
-                if (updated)
+                if (l->isAvailable() && l->hasColor() && l->state() != LightNode::StateDeleted && l->isColorLoopActive())
                 {
-                    updateLightEtag(&*l);
+                    TaskItem task2;
+                    task2.lightNode = l;
+                    task2.req.dstAddress() = task2.lightNode->address();
+                    task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+                    task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
+                    task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
+                    task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
+
+                    addTaskSetColorLoop(task2, false, 15);
+                    l->setColorLoopActive(false);
+                    updated = true;
                 }
             }
+
+            if (updated)
+            {
+                updateLightEtag(l);
+            }
         }
 
         updateEtag(gwConfigEtag);
@@ -7161,7 +7291,7 @@ void DeRestPluginPrivate::handleCommissioningClusterIndication(TaskItem &task, c
                     //not found
                     group1->addDeviceMembership(sensorNode->id());
                     queSaveDb(DB_GROUPS, DB_SHORT_SAVE_DELAY);
-                    updateEtag(group1->etag);
+                    updateGroupEtag(group1);
                 }
 
                 ResourceItem *item = sensorNode->addItem(DataTypeString, RConfigGroup);
@@ -7186,8 +7316,8 @@ void DeRestPluginPrivate::handleCommissioningClusterIndication(TaskItem &task, c
  */
 void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndication &ind)
 {
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
 
     quint16 nwk;
     quint64 ext;
@@ -7284,13 +7414,13 @@ void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndic
             }
 
             queryTime = queryTime.addSecs(1);
-            updateEtag(i->etag);
+            updateLightEtag(&*i);
         }
     }
 
     int found = 0;
-    std::vector<Sensor>::iterator si = sensors.begin();
-    std::vector<Sensor>::iterator send = sensors.end();
+    SlotMap<Sensor>::iterator si = sensors.begin();
+    SlotMap<Sensor>::iterator send = sensors.end();
 
     for (; si != send; ++si)
     {
@@ -7362,16 +7492,13 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
             group = &dummyGroup;
         }
 
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
-
-        for (; i != end; ++i)
+        if (group->id() == "0")
         {
-            LightNode *lightNode = &(*i);
-            if (isLightNodeInGroup(lightNode, task.req.dstAddress().group()) || group->id() == "0")
-            {
-                pushNodes.push_back(lightNode);
-            }
+            getLightNodesInGroup(0, pushNodes);
+        }
+        else
+        {
+            getLightNodesInGroup(task.req.dstAddress().group(), pushNodes);
         }
     }
     else if (task.lightNode)
@@ -7399,7 +7526,7 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
     switch (task.taskType)
     {
     case TaskSendOnOffToggle:
-        updateEtag(group->etag);
+        updateGroupEtag(group);
         group->setIsOn(task.onOff);
 
         if (!task.lightNode && group->id() == "0")
@@ -7411,7 +7538,7 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
             {
                 if (g->state() != Group::StateDeleted && g->state() != Group::StateDeleteFromDB)
                 {
-                    updateEtag(g->etag);
+                    updateGroupEtag(g);
                     g->setIsOn(task.onOff);
                 }
             }
@@ -7530,7 +7657,7 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
             break;
 
         case TaskStopLevel:
-            updateEtag(lightNode->etag);
+            updateLightEtag(lightNode);
             lightNode->enableRead(READ_LEVEL);
             lightNode->mustRead(READ_LEVEL);
             break;
@@ -7707,7 +7834,7 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
             }
             else
             {
-                updateEtag(lightNode->etag);
+                updateLightEtag(lightNode);
                 lightNode->setColorLoopActive(task.colorLoop);
                 setAttributeColorLoopActive(lightNode);
             }
@@ -8177,7 +8304,10 @@ void DeRestPluginPrivate::updateSensorEtag(Sensor *sensorNode)
 {
     if (sensorNode)
     {
-        updateEtag(sensorNode->etag);
+        sensorsChanges.remove(sensorNode->version);
+        sensorNode->version = updateEtag(sensorNode->etag);
+        sensorsChanges.insert(sensorNode->version, sensorNode->id());
+        gwSensorsVersion = sensorNode->version;
         gwSensorsEtag = sensorNode->etag;
         gwConfigEtag = sensorNode->etag;
     }
@@ -8189,7 +8319,10 @@ void DeRestPluginPrivate::updateLightEtag(LightNode *lightNode)
 {
     if (lightNode)
     {
-        updateEtag(lightNode->etag);
+        lightsChanges.remove(lightNode->version);
+        lightNode->version = updateEtag(lightNode->etag);
+        lightsChanges.insert(lightNode->version, lightNode->id());
+        gwLightsVersion = lightNode->version;
         gwLightsEtag = lightNode->etag;
         gwConfigEtag = lightNode->etag;
     }
@@ -8201,12 +8334,29 @@ void DeRestPluginPrivate::updateGroupEtag(Group *group)
 {
     if (group)
     {
-        updateEtag(group->etag);
+        groupsChanges.remove(group->version);
+        group->version = updateEtag(group->etag);
+        groupsChanges.insert(group->version, group->id());
+        gwGroupsVersion = group->version;
         gwGroupsEtag = group->etag;
         gwConfigEtag = group->etag;
     }
 }
 
+/*! Shall be called whenever the rule changed.
+ */
+void DeRestPluginPrivate::updateRuleEtag(Rule *rule)
+{
+    if (rule)
+    {
+        rulesChanges.remove(rule->version);
+        rule->version = updateEtag(rule->etag);
+        rulesChanges.insert(rule->version, rule->id());
+        gwRulesEtag = rule->etag;
+        gwConfigEtag = rule->etag;
+    }
+}
+
 /*! Shall be called whenever the user did something which resulted in a over the air request.
  */
 void DeRestPluginPrivate::userActivity()
@@ -8286,6 +8436,36 @@ DeRestPlugin::~DeRestPlugin()
     d = 0;
 }
 
+/*! Light items which are polled periodically, the index is the PollScheduler item.
+    Items with a cluster aren't polled while the light reports the attribute within the interval.
+ */
+static const uint32_t pollItems[]    = { READ_ON_OFF, READ_LEVEL, READ_COLOR, READ_GROUPS, READ_SCENES, 0 };
+static const int pollIntervals[]     = {         120,        120,        240,         600,         600, 0 }; // s
+static const quint16 pollClusters[]  = {      0x0006,     0x0008,     0x0300,      0xffff,      0xffff, 0 };
+static const quint16 pollAttrs[]     = {      0x0000,     0x0000,     0x0003,           0,           0, 0 };
+
+/*! Pushes back polling of the item of a light which is covered by an attribute report.
+    \param lightNode - the light which sent the report
+    \param clusterId - cluster of the reported attribute
+    \param attributeId - the reported attribute
+ */
+void DeRestPluginPrivate::pollReportReceived(const LightNode *lightNode, quint16 clusterId, quint16 attributeId)
+{
+    size_t slot;
+    if (!lightNode || !nodes.slotOf(lightNode, &slot))
+    {
+        return;
+    }
+
+    for (int i = 0; pollItems[i] != 0; i++)
+    {
+        if (pollClusters[i] == clusterId && pollAttrs[i] == attributeId)
+        {
+            pollScheduler.reportReceived(slot, i, steadyTimeRef());
+        }
+    }
+}
+
 /*! Handle idle states.
 
     After IDLE_LIMIT seconds user inactivity this timer
@@ -8316,6 +8496,16 @@ void DeRestPlugin::idleTimerFired()
         d->idleLimit--;
     }
 
+    if ((d->idleTotalCounter % API_AUTH_FLUSH_INTERVAL) == 0 && d->flushApiAuthLastUse())
+    {
+        d->queSaveDb(DB_AUTH, DB_HUGE_SAVE_DELAY);
+    }
+
+    if ((d->idleTotalCounter % TASK_ROUTE_REFRESH_INTERVAL) == 0)
+    {
+        d->updateTaskRoutes();
+    }
+
     if (d->idleLastActivity < IDLE_USER_LIMIT)
     {
         return;
@@ -8384,75 +8574,90 @@ void DeRestPlugin::idleTimerFired()
 
         if (!d->nodes.empty())
         {
-            if (d->lightIter >= d->nodes.size())
-            {
-                d->lightIter = 0;
-            }
+            const SteadyTimeRef now = steadyTimeRef();
+            size_t slot;
+            size_t polledSlot = 0;
+            bool polledLight = false; // polledSlot is valid
+            int item;
 
-            while (d->lightIter < d->nodes.size())
+            // poll the items which are due and weren't reported recently, one light per tick
+            while (d->pollScheduler.nextDue(now, &slot, &item))
             {
-                LightNode *lightNode = &d->nodes[d->lightIter];
-                d->lightIter++;
-
-                if (!lightNode->isAvailable())
+                if (polledLight && slot != polledSlot)
                 {
-                    continue;
+                    d->pollScheduler.defer(slot, item, now); // next tick
+                    break;
                 }
 
-                if (processLights)
+                LightNode *lightNode = &d->nodes[slot];
+
+                if (!lightNode->isAvailable() || lightNode->mustRead(pollItems[item]) ||
+                    (pollClusters[item] == COLOR_CLUSTER_ID && !lightNode->hasColor()))
                 {
-                    break;
+                    d->pollScheduler.defer(slot, item, now.addSecs(pollIntervals[item]));
+                    continue;
                 }
 
-                const uint32_t items[]   = { READ_ON_OFF, READ_LEVEL, READ_COLOR, READ_GROUPS, READ_SCENES, 0 };
-                const int tRead[]        = {         120,        120,        240,         600,         600, 0 };
-                const quint16 clusters[] = {      0x0006,     0x0008,     0x0300,      0xffff,      0xffff, 0 };
-                const quint16 attrs[]    = {      0x0000,     0x0000,     0x0003,           0,           0, 0 };
-
-                for (size_t i = 0; items[i] != 0; i++)
+                if (pollItems[item] == READ_GROUPS || pollItems[item] == READ_SCENES)
                 {
-                    if (lightNode->mustRead(items[i]))
+                    // don't query low priority items when OTA is busy
+                    if (d->otauLastBusyTimeDelta() < OTA_LOW_PRIORITY_TIME)
                     {
+                        d->pollScheduler.defer(slot, item, now.addSecs(OTA_LOW_PRIORITY_TIME));
                         continue;
                     }
+                }
 
-                    if (items[i] == READ_GROUPS || items[i] == READ_SCENES)
+                if (pollClusters[item] != 0xffff)
+                {
+                    const NodeValue &val = lightNode->getZclValue(pollClusters[item], pollAttrs[item]);
+
+                    if (val.updateType == NodeValue::UpdateByZclRead ||
+                        val.updateType == NodeValue::UpdateByZclReport)
                     {
-                        // don't query low priority items when OTA is busy
-                        if (d->otauLastBusyTimeDelta() < OTA_LOW_PRIORITY_TIME)
+                        if (val.timestamp.isValid() && val.timestamp.msecsTo(now) < (pollIntervals[item] * 1000))
                         {
+                            // fresh enough
+                            d->pollScheduler.defer(slot, item, val.timestamp.addSecs(pollIntervals[item]));
                             continue;
                         }
                     }
+                }
 
-                    if (lightNode->lastRead(items[i]) < (d->idleTotalCounter - tRead[i]))
-                    {
-                        if (clusters[i] == COLOR_CLUSTER_ID && !lightNode->hasColor())
-                        {
-                            continue;
-                        }
+                lightNode->setNextReadTime(pollItems[item], d->queryTime);
+                lightNode->setLastRead(pollItems[item], d->idleTotalCounter);
+                lightNode->enableRead(pollItems[item]);
+                d->queryTime = d->queryTime.addSecs(tSpacing);
+                d->pollScheduler.polled(slot, item, now);
+                polledSlot = slot;
+                polledLight = true;
+                processLights = true;
+            }
 
-                        if (clusters[i] != 0xffff)
-                        {
-                            const NodeValue &val = lightNode->getZclValue(clusters[i], attrs[i]);
+            if (d->lightIter >= d->nodes.size())
+            {
+                d->lightIter = 0;
+            }
 
-                            if (val.updateType == NodeValue::UpdateByZclRead ||
-                                val.updateType == NodeValue::UpdateByZclReport)
-                            {
-                                if (val.timestamp.isValid() && val.timestamp.elapsed() < (tRead[i] * 1000))
-                                {
-                                    // fresh enough
-                                    continue;
-                                }
-                            }
-                        }
+            while (d->lightIter < d->nodes.size())
+            {
+                LightNode *lightNode = &d->nodes[d->lightIter];
+                d->lightIter++;
+                d->indexLightGroups(lightNode); // catch up with state changes which didn't raise an event
 
-                        lightNode->setNextReadTime(items[i], d->queryTime);
-                        lightNode->setLastRead(items[i], d->idleTotalCounter);
-                        lightNode->enableRead(items[i]);
-                        d->queryTime = d->queryTime.addSecs(tSpacing);
-                        processLights = true;
-                    }
+                if (!lightNode->isAvailable())
+                {
+                    continue;
+                }
+
+                for (int i = 0; pollItems[i] != 0; i++)
+                {
+                    d->pollScheduler.schedule(d->lightIter - 1, i, pollIntervals[i], now);
+                }
+
+                if (processLights)
+                {
+                    break;
                 }
 
                 if (lightNode->modelId().isEmpty())
@@ -8618,7 +8823,7 @@ void DeRestPlugin::idleTimerFired()
                         }
 
                         if (val.timestampLastReport.isValid() &&
-                            val.timestampLastReport.secsTo(t) < (60 * 45)) // got update in timely manner
+                            val.timestampLastReport.secsTo(steadyTimeRef()) < (60 * 45)) // got update in timely manner
                         {
                             DBG_Printf(DBG_INFO_L2, "binding for attribute reporting SensorNode %s of cluster 0x%04X seems to be active\n", qPrintable(sensorNode->name()), *ci);
                         }
@@ -8637,7 +8842,7 @@ void DeRestPlugin::idleTimerFired()
                             {
                                 val = sensorNode->getZclValue(*ci, 0x0010); // PIR occupied to unoccupied delay
 
-                                if (!val.timestamp.isValid() || val.timestamp.secsTo(t) > 1800)
+                                if (!val.timestamp.isValid() || val.timestamp.secsTo(steadyTimeRef()) > 1800)
                                 {
                                     sensorNode->enableRead(READ_OCCUPANCY_CONFIG);
                                     sensorNode->setLastRead(READ_OCCUPANCY_CONFIG, d->idleTotalCounter);
@@ -8669,8 +8874,8 @@ void DeRestPlugin::idleTimerFired()
         }
 
         {
-            std::vector<LightNode>::iterator i = d->nodes.begin();
-            std::vector<LightNode>::iterator end = d->nodes.end();
+            SlotMap<LightNode>::iterator i = d->nodes.begin();
+            SlotMap<LightNode>::iterator end = d->nodes.end();
 
             int countNoColorXySupport = 0;
 
@@ -8952,6 +9157,61 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
     return false;
 }
 
+/*! Returns the route of a request under which its handling time is recorded.
+    Only the method and the first resource segment are used to keep the number of routes small.
+    Both are taken from fixed lists, since requests are recorded before their apikey is checked.
+ */
+static QString perfRoute(const ApiRequest &req, int ret)
+{
+    static const char *methods[] = { "GET", "PUT", "POST", "DELETE", "PATCH", 0 };
+    static const char *resources[] = { "lights", "groups", "schedules", "touchlink", "sensors", "resourcelinks",
+                                       "rules", "userparameter", "gateways", "config", 0 };
+
+    if (ret == REQ_NOT_HANDLED)
+    {
+        return QLatin1String("unknown");
+    }
+
+    QString route = QLatin1String("other ");
+
+    for (int i = 0; methods[i]; i++)
+    {
+        if (req.hdr.method() == QLatin1String(methods[i]))
+        {
+            route = QLatin1String(methods[i]);
+            route += QLatin1Char(' ');
+            break;
+        }
+    }
+
+    if (req.path.size() > 1 && req.path[1] == QLatin1String("config"))
+    {
+        route += QLatin1String("config"); // /api/config
+    }
+    else if (req.path.size() > 2)
+    {
+        int i = 0;
+        for (; resources[i]; i++)
+        {
+            if (req.path[2] == QLatin1String(resources[i]))
+            {
+                break;
+            }
+        }
+        route += resources[i] ? QLatin1String(resources[i]) : QLatin1String("other");
+    }
+    else if (req.path.size() == 2)
+    {
+        route += QLatin1String("fullstate");
+    }
+    else
+    {
+        route += QLatin1String("api");
+    }
+
+    return route;
+}
+
 /*! Broker for any incoming REST API request.
     \param hdr - http request header
     \param sock - the client socket
@@ -9009,6 +9269,11 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
 
     QStringList path = hdrmod.path().split(QLatin1String("/"), QString::SkipEmptyParts);
     ApiRequest req(hdrmod, path, sock, content);
+#if QT_VERSION < 0x050000
+    req.query = QString::fromLatin1(url.encodedQuery());
+#else
+    req.query = url.query();
+#endif
     ApiResponse rsp;
 
     rsp.httpStatus = HttpStatusNotFound;
@@ -9074,6 +9339,9 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         return 0;
     }
 
+    QElapsedTimer perfTimer;
+    perfTimer.start();
+
     if (path.size() > 2)
     {
         if (path[2] == QLatin1String("lights"))
@@ -9121,6 +9389,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
 
     if (ret == REQ_DONE)
     {
+        perfCounters().recordHttpRequest(perfRoute(req, ret), perfTimer.nsecsElapsed() / 1000);
         return 0;
     }
     else if (ret == REQ_READY_SEND)
@@ -9168,10 +9437,15 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     }
     else if (!rsp.str.isEmpty())
     {
-        rsp.contentType = HttpContentJson;
+        if (rsp.contentType == HttpContentHtml) // not set by the handler
+        {
+            rsp.contentType = HttpContentJson;
+        }
         str = rsp.str;
     }
 
+    perfCounters().recordHttpRequest(perfRoute(req, ret), perfTimer.nsecsElapsed() / 1000);
+
     stream << "HTTP/1.1 " << rsp.httpStatus << "\r\n";
     stream << "Access-Control-Allow-Origin: *\r\n";
     stream << "Content-Type: " << rsp.contentType << "\r\n";
@@ -11,11 +11,15 @@
 #ifndef DE_WEB_PLUGIN_PRIVATE_H
 #define DE_WEB_PLUGIN_PRIVATE_H
 #include <QtGlobal>
+#include <QHash>
+#include <QMap>
 #include <QObject>
 #include <QTime>
 #include <QTimer>
 #include <QElapsedTimer>
 #include <stdint.h>
+#include <deque>
+#include <list>
 #include <queue>
 #if QT_VERSION < 0x050000
 #include <QHttpRequestHeader>
@@ -34,6 +38,11 @@
 #include "resourcelinks.h"
 #include "rule.h"
 #include "bindings.h"
+#include "device_index.h"
+#include "group_index.h"
+#include "poll_scheduler.h"
+#include "perf_counters.h"
+#include "slot_map.h"
 #include <math.h>
 #include "websocket_server.h"
 
@@ -69,6 +78,7 @@
 #define IDLE_READ_LIMIT 120
 #define IDLE_USER_LIMIT 20
 #define IDLE_ATTR_REPORT_BIND_LIMIT 240
+#define API_AUTH_FLUSH_INTERVAL (60 * 30) // idle timer ticks between folding api key last use into the database
 
 #define MAX_UNLOCK_GATEWAY_TIME 600
 #define PERMIT_JOIN_SEND_INTERVAL (1000 * 160)
@@ -118,6 +128,29 @@
 #define DEV_ID_ZLL_ONOFF_SENSOR             0x0850 // On/Off sensor
 
 #define DEFAULT_TRANSITION_TIME 4 // 400ms
+
+#define EVENT_QUEUE_DELAY            50 // ms to collect events before the queue is drained
+#define EVENT_BATCH_BUDGET           20 // ms of event handling per event loop turn
+
+#define MAX_TASKS                    512 // queued tasks in total
+#define MAX_TASKS_PER_DESTINATION    24 // queued tasks per destination
+#define TASK_RETRY_INTERVAL          100 // ms to wait when queued tasks are deferred
+#define APS_REQUEST_SLOTS            256 // in-flight table size, one slot per APS request id
+#define READ_BATCH_WINDOW            50 // ms to collect attribute reads of a cluster into one frame
+#define READ_ATTRIBUTES_MAX          32 // attribute ids per Read Attributes frame (APS payload limit)
+#define READ_BATCH_RETRY_DELAY       1000 // ms until a batch which couldn't be queued is tried again
+#define READ_BATCH_MAX_RETRIES       10 // a batch is dropped after this many failed attempts
+#define TASK_SWEEP_INTERVAL          1000 // ms between checks for unconfirmed requests
+#define TASK_WINDOW_MIN              1 // smallest in-flight window (unconfirmed requests)
+#define TASK_WINDOW_INITIAL          2
+#define TASK_WINDOW_MAX_DESTINATION  4
+#define TASK_WINDOW_MAX_ROUTE        6
+#define TASK_WINDOW_INITIAL_GLOBAL   5
+#define TASK_WINDOW_MAX_GLOBAL       10
+#define TASK_TIMEOUT_INITIAL         10000 // ms to wait for a confirm before the round trip time is known
+#define TASK_TIMEOUT_MIN             2000 // bounds of the confirm timeout derived from the round trip time
+#define TASK_TIMEOUT_MAX             20000
+#define TASK_ROUTE_REFRESH_INTERVAL  60 // idle timer ticks between updates of the end device parent map
 #define MAX_ENHANCED_HUE 65535
 #define MAX_ENHANCED_HUE_Z 65278 // max supportet ehue of all devices
 
@@ -190,6 +223,10 @@
 
 #define MAX_GROUP_SEND_DELAY 5000 // ms between to requests to the same group
 #define GROUP_SEND_DELAY 500 // default ms between to requests to the same group
+#define GROUP_SEND_BURST 2 // requests to the same group which may be sent without delay
+#define BROADCAST_BUDGET 10 // broadcasts and groupcasts per BROADCAST_BUDGET_WINDOW
+#define BROADCAST_BUDGET_WINDOW 9000 // ms a broadcast occupies the broadcast transaction table
+#define BROADCAST_MAX_WAIT 10000 // ms a deferred background or replaceable broadcast/groupcast is kept queued
 
 #define MAX_SENSORS 1000
 #define MAX_RULE_ILLUMINANCE_VALUE_AGE_MS (1000 * 60 * 20) // 20 minutes
@@ -264,6 +301,7 @@ extern const char *HttpContentJS;
 extern const char *HttpContentPNG;
 extern const char *HttpContentJPG;
 extern const char *HttpContentSVG;
+extern const char *HttpContentText;
 
 // Forward declarations
 class Gateway;
@@ -390,10 +428,20 @@ enum TaskType
     TaskViewGroup
 };
 
+/*! Scheduling class of a TaskItem, lower values are sent first. */
+enum TaskPriority
+{
+    TaskPriorityUser,       //!< commands issued through the REST API
+    TaskPriorityRule,       //!< rule actions
+    TaskPriorityBackground, //!< attribute reads and membership queries
+    TaskPriorityMax
+};
+
 struct TaskItem
 {
     TaskItem()
     {
+        priority = TaskPriorityUser;
         autoMode = false;
         onOff = false;
         client = 0;
@@ -404,14 +452,17 @@ struct TaskItem
         colorY = 0;
         colorTemperature = 0;
         transitionTime = DEFAULT_TRANSITION_TIME;
-        sendTime = 0;
+        routeAddr = 0;
     }
 
     TaskType taskType;
+    TaskPriority priority; // set by addTask()
     deCONZ::ApsDataRequest req;
     deCONZ::ZclFrame zclFrame;
     uint8_t zclSeq;
-    int sendTime; // copy of idleTotalCounter
+    SteadyTimeRef queueTime; // set when the task is queued
+    SteadyTimeRef sendTime; // set when the request is handed to the APS layer
+    quint64 routeAddr; // parent router of an end device destination or 0
     bool confirmed;
     bool onOff;
     bool colorLoop;
@@ -436,6 +487,169 @@ struct TaskItem
     deCONZ::ZclCluster *cluster;
 };
 
+/*! \class TaskDstKey
+
+    Identifies the destination of a task (group, extended or network address).
+    Unicasts are keyed by the extended address whenever it is known,
+    see DeRestPluginPrivate::resolveTaskDstAddress().
+ */
+class TaskDstKey
+{
+public:
+    TaskDstKey() : mode(0), addr(0) { }
+    TaskDstKey(quint8 m, quint64 a) : mode(m), addr(a) { }
+    bool operator==(const TaskDstKey &other) const { return mode == other.mode && addr == other.addr; }
+    quint8 mode; // deCONZ::ApsAddressMode
+    quint64 addr;
+};
+
+inline uint qHash(const TaskDstKey &key)
+{
+    return qHash(key.addr) ^ key.mode;
+}
+
+/*! \class TaskDedupeKey
+
+    Queued tasks with the same key are replaced by newer ones.
+ */
+class TaskDedupeKey
+{
+public:
+    TaskDedupeKey(const TaskDstKey &d, quint8 ep, quint16 cl, TaskType t) : dst(d), endpoint(ep), clusterId(cl), taskType(t) { }
+    bool operator==(const TaskDedupeKey &other) const
+    {
+        return dst == other.dst && endpoint == other.endpoint && clusterId == other.clusterId && taskType == other.taskType;
+    }
+    TaskDstKey dst;
+    quint8 endpoint;
+    quint16 clusterId;
+    TaskType taskType;
+};
+
+inline uint qHash(const TaskDedupeKey &key)
+{
+    return qHash(key.dst) ^ (uint(key.clusterId) << 16) ^ (uint(key.endpoint) << 8) ^ uint(key.taskType);
+}
+
+/*! \class TaskWindow
+
+    AIMD window of unconfirmed requests towards a destination, a route or the whole network.
+    The window grows by one request per window of successful confirms and is halved on
+    errors and timeouts. The confirm timeout follows the smoothed round trip time.
+ */
+class TaskWindow
+{
+public:
+    TaskWindow(double initial = TASK_WINDOW_INITIAL, double max = TASK_WINDOW_MAX_DESTINATION);
+    bool isOpen() const { return onAir < int(window); }
+    int timeout() const;
+    void sent() { onAir++; }
+    void confirmed(int rtt);
+    void failed(bool timedOut);
+
+    double window;
+    double maxWindow;
+    int onAir; // unconfirmed requests
+    int srtt; // smoothed round trip time in ms, 0 until measured
+    int rttvar; // round trip time variation in ms
+    quint32 confirms;
+    quint32 errors;
+    quint32 timeouts;
+};
+
+/*! \class TokenBucket
+
+    Rate limiter which holds up to \c capacity tokens and gains one token every \c interval ms.
+ */
+class TokenBucket
+{
+public:
+    TokenBucket(double cap = 1, int ival = 1000) : tokens(cap), capacity(cap), interval(ival) { }
+    bool isAvailable(const SteadyTimeRef &now);
+    void take() { tokens -= 1; }
+
+    double tokens;
+    double capacity;
+    int interval;
+    SteadyTimeRef lastRefill;
+};
+
+/*! \class TaskDestinationQueue
+
+    FIFO queues of one destination, one per TaskPriority.
+ */
+class TaskDestinationQueue
+{
+public:
+    TaskDestinationQueue()
+    {
+        for (int p = 0; p < TaskPriorityMax; p++) { ready[p] = false; }
+    }
+    size_t queued() const
+    {
+        size_t n = 0;
+        for (int p = 0; p < TaskPriorityMax; p++) { n += queue[p].size(); }
+        return n;
+    }
+    std::deque<std::list<TaskItem>::iterator> queue[TaskPriorityMax];
+    bool ready[TaskPriorityMax]; // true if listed in DeRestPluginPrivate::taskReady[p]
+    TaskWindow window;
+};
+
+/*! \class TaskPriorityScope
+
+    Sets the priority of tasks which are created within a scope.
+ */
+class TaskPriorityScope
+{
+public:
+    TaskPriorityScope(TaskPriority &context, TaskPriority priority) : m_context(context), m_prev(context) { m_context = priority; }
+    ~TaskPriorityScope() { m_context = m_prev; }
+private:
+    TaskPriority &m_context;
+    TaskPriority m_prev;
+};
+
+/*! Owner of an APS request which waits for its APSDE-DATA.confirm. */
+enum ApsRequestOwner
+{
+    ApsOwnerNone,
+    ApsOwnerTask,
+    ApsOwnerBindingTableReader,
+    ApsOwnerChannelChange,
+    ApsOwnerResetDevice
+};
+
+/*! \class ApsRequestSlot
+
+    Entry of the in-flight table which is indexed by APS request id.
+ */
+class ApsRequestSlot
+{
+public:
+    ApsRequestSlot() : owner(ApsOwnerNone), latency(-1) { }
+    ApsRequestOwner owner;
+    SteadyTimeRef sendTime;
+    int latency; // ms from send to confirm of the last request with this id, -1 if unknown
+    TaskItem task; // the running task if owner is ApsOwnerTask
+};
+
+/*! \class ReadAttributesBatch
+
+    Attribute reads of one cluster which are collected into a single Read Attributes frame.
+ */
+class ReadAttributesBatch
+{
+public:
+    ReadAttributesBatch() : endpoint(0), clusterId(0), retries(0) { }
+    deCONZ::Address address;
+    quint8 endpoint;
+    quint16 clusterId;
+    std::vector<uint16_t> attributes;
+    SteadyTimeRef due; // when the frame is sent
+    int retries; // failed attempts to queue the frame
+};
+
 /*! \class ApiAuth
 
     Helper to combine serval authentification parameters.
@@ -456,8 +670,10 @@ public:
     QString apikey; // also called username (10..32 chars)
     QString devicetype;
     QDateTime createDate;
-    QDateTime lastUseDate;
+    QDateTime lastUseDate; // minute granularity, updated from lastUse by flushApiAuthLastUse()
     QString useragent;
+    SteadyTimeRef lastUse; // set on each authenticated request
+    SteadyTimeRef lastUseFlushed; // lastUse which was folded into lastUseDate
 };
 
 enum ApiVersion
@@ -475,12 +691,14 @@ class ApiRequest
 public:
     ApiRequest(const QHttpRequestHeader &h, const QStringList &p, QTcpSocket *s, const QString &c);
     QString apikey() const;
+    QString queryItem(const QString &key) const;
     ApiVersion apiVersion() const { return version; }
 
     const QHttpRequestHeader &hdr;
     const QStringList &path;
     QTcpSocket *sock;
     QString content;
+    QString query; // URL query string without '?'
     ApiVersion version;
 };
 
@@ -530,6 +748,9 @@ public:
     void initAuthentification();
     bool allowedToCreateApikey(const ApiRequest &req);
     bool checkApikeyAuthentification(const ApiRequest &req, ApiResponse &rsp);
+    ApiAuth *getApiAuthForKey(const QString &apikey);
+    void indexApiAuth(size_t idx);
+    bool flushApiAuthLastUse();
     QString encryptString(const QString &str);
 
     // REST API gateways
@@ -557,6 +778,10 @@ public:
     int changePassword(const ApiRequest &req, ApiResponse &rsp);
     int deletePassword(const ApiRequest &req, ApiResponse &rsp);
     int getWifiState(const ApiRequest &req, ApiResponse &rsp);
+    int getTaskState(const ApiRequest &req, ApiResponse &rsp);
+    int getPerfCounters(const ApiRequest &req, ApiResponse &rsp);
+    int getPerfMetrics(const ApiRequest &req, ApiResponse &rsp);
+    int resetPerfCounters(const ApiRequest &req, ApiResponse &rsp);
     int restoreWifiConfig(const ApiRequest &req, ApiResponse &rsp);
 
     void configToMap(const ApiRequest &req, QVariantMap &map);
@@ -586,6 +811,9 @@ public:
     void handleLightEvent(const Event &e);
 
     bool lightToMap(const ApiRequest &req, const LightNode *webNode, QVariantMap &map);
+    const QByteArray &lightToJson(const ApiRequest &req, LightNode *lightNode);
+    QByteArray lightsToJson(const ApiRequest &req);
+    QByteArray lightsDeltaToJson(const ApiRequest &req, quint64 since);
 
     // REST API groups
     int handleGroupsApi(ApiRequest &req, ApiResponse &rsp);
@@ -609,6 +837,9 @@ public:
     int deleteScene(const ApiRequest &req, ApiResponse &rsp);
 
     bool groupToMap(const Group *group, QVariantMap &map);
+    const QByteArray &groupToJson(Group *group);
+    QByteArray groupsToJson();
+    QByteArray groupsDeltaToJson(quint64 since);
 
     // REST API schedules
     void initSchedules();
@@ -642,6 +873,9 @@ public:
     int getGroupIdentifiers(const ApiRequest &req, ApiResponse &rsp);
     int recoverSensor(const ApiRequest &req, ApiResponse &rsp);
     bool sensorToMap(const Sensor *sensor, QVariantMap &map);
+    const QByteArray &sensorToJson(Sensor *sensor);
+    QByteArray sensorsToJson();
+    QByteArray sensorsDeltaToJson(quint64 since);
     void handleSensorEvent(const Event &e);
 
     // REST API resourcelinks
@@ -663,6 +897,9 @@ public:
     void triggerRuleIfNeeded(Rule &rule);
     void triggerRule(Rule &rule);
     bool ruleToMap(const Rule *rule, QVariantMap &map);
+    const QByteArray &ruleToJson(Rule *rule);
+    QByteArray rulesToJson();
+    QByteArray rulesDeltaToJson(quint64 since);
 
     bool checkActions(QVariantList actionsList, ApiResponse &rsp);
     bool checkConditions(QVariantList conditionsList, ApiResponse &rsp);
@@ -716,6 +953,11 @@ public Q_SLOTS:
     void gpProcessButtonEvent(const deCONZ::GpDataIndication &ind);
     int taskCountForAddress(const deCONZ::Address &address);
     void processTasks();
+    void flushReadBatches();
+    void clearTasks();
+    ApsRequestSlot &registerApsRequest(const deCONZ::ApsDataRequest &req, ApsRequestOwner owner);
+    void finishRunningTask(quint8 id, const deCONZ::ApsDataConfirm *conf);
+    void updateTaskRoutes();
     void processGroupTasks();
     void nodeEvent(const deCONZ::NodeEvent &event);
     void internetDiscoveryTimerFired();
@@ -794,6 +1036,7 @@ public Q_SLOTS:
     void checkSensorStateTimerFired();
 
     // events
+    void eventLoopAwake();
     void initEventQueue();
     void eventQueueTimerFired();
     void enqueueEvent(const Event &event);
@@ -819,7 +1062,9 @@ public:
     void checkRfConnectState();
     bool isInNetwork();
     void generateGatewayUuid();
-    void updateEtag(QString &etag);
+    quint64 updateEtag(QString &etag);
+    bool checkEtag(const ApiRequest &req, ApiResponse &rsp, const QString &etag);
+    bool sinceVersion(const ApiRequest &req, quint64 *since);
     qint64 getUptime();
     void addLightNode(const deCONZ::Node *node);
     void nodeZombieStateChanged(const deCONZ::Node *node);
@@ -827,6 +1072,7 @@ public:
     LightNode *getLightNodeForAddress(const deCONZ::Address &addr, quint8 endpoint = 0);
     int getNumberOfEndpoints(quint64 extAddr);
     LightNode *getLightNodeForId(const QString &id);
+    void indexLightNode(const LightNode *lightNode);
     Rule *getRuleForId(const QString &id);
     Rule *getRuleForName(const QString &name);
     void addSensorNode(const deCONZ::Node *node);
@@ -842,6 +1088,7 @@ public:
     Sensor *getSensorNodeForFingerPrint(quint64 extAddr, const SensorFingerprint &fingerPrint, const QString &type);
     Sensor *getSensorNodeForUniqueId(const QString &uniqueId);
     Sensor *getSensorNodeForId(const QString &id);
+    void indexSensorNode(const Sensor *sensor);
     Group *getGroupForName(const QString &name);
     Group *getGroupForId(uint16_t id);
     Group *getGroupForId(const QString &id);
@@ -857,12 +1104,16 @@ public:
     bool readBindingTable(RestNodeBase *node, quint8 startIndex);
     bool getGroupIdentifiers(RestNodeBase *node, quint8 endpoint, quint8 startIndex);
     bool readAttributes(RestNodeBase *restNode, quint8 endpoint, uint16_t clusterId, const std::vector<uint16_t> &attributes);
+    bool sendReadAttributes(const ReadAttributesBatch &batch, size_t first, size_t count);
     bool writeAttribute(RestNodeBase *restNode, quint8 endpoint, uint16_t clusterId, const deCONZ::ZclAttribute &attribute);
     bool readSceneAttributes(LightNode *lightNode, uint16_t groupId, uint8_t sceneId);
     bool readGroupMembership(LightNode *lightNode, const std::vector<uint16_t> &groups);
     void foundGroupMembership(LightNode *lightNode, uint16_t groupId);
     void foundGroup(uint16_t groupId);
     bool isLightNodeInGroup(const LightNode *lightNode, uint16_t groupId) const;
+    void getLightNodesInGroup(uint16_t groupId, std::vector<LightNode*> &lightNodes);
+    void indexLightGroups(const LightNode *lightNode);
+    void pollReportReceived(const LightNode *lightNode, quint16 clusterId, quint16 attributeId);
     void deleteLightFromScenes(QString lightId, uint16_t groupId);
 //    void readAllInGroup(Group *group);
     void setAttributeOnOffGroup(Group *group, uint8_t onOff);
@@ -889,6 +1140,14 @@ public:
 
     // Task interface
     bool addTask(const TaskItem &task);
+    bool coalesceTask(const TaskItem &task);
+    std::list<TaskItem>::iterator findQueuedTask(const TaskItem &task, quint16 clusterId, TaskType taskType);
+    void replaceQueuedTask(std::list<TaskItem>::iterator i, const TaskItem &task);
+    void removeQueuedTask(std::list<TaskItem>::iterator i);
+    void dequeueTask(std::list<TaskItem>::iterator i);
+    void resolveTaskDstAddress(deCONZ::Address &address);
+    void pruneTaskDestination(QHash<TaskDstKey, TaskDestinationQueue>::iterator d);
+    int sendTask(std::list<TaskItem>::iterator i, TaskDestinationQueue &dst, const SteadyTimeRef &now);
     bool addTaskMoveLevel(TaskItem &task, bool withOnOff, bool upDirection, quint8 rate);
     bool addTaskSetOnOff(TaskItem &task, quint8 cmd, quint16 ontime);
     bool addTaskSetBrightness(TaskItem &task, uint8_t bri, bool withOnOff);
@@ -939,6 +1198,7 @@ public:
     void updateSensorEtag(Sensor *sensorNode);
     void updateLightEtag(LightNode *lightNode);
     void updateGroupEtag(Group *group);
+    void updateRuleEtag(Rule *rule);
 
     // Database interface
     void initDb();
@@ -980,8 +1240,8 @@ public:
     GatewayScanner *gwScanner;
 
     // authentification
-    QTime apiAuthSaveDatabaseTime;
     std::vector<ApiAuth> apiAuths;
+    QHash<QString, size_t> apiAuthIndex; // apikey --> index in apiAuths of active keys
     QString gwAdminUserName;
     QString gwAdminPasswordHash;
 
@@ -1022,6 +1282,17 @@ public:
     QString gwLightsEtag;
     QString gwGroupsEtag;
     QString gwConfigEtag;
+    QString gwRulesEtag;
+    QString gwSchedulesEtag;
+    quint64 etagVersion; // version clock of all etags
+    quint64 etagBaseVersion; // first version of this run
+    quint64 gwSensorsVersion; // largest version of all sensors
+    quint64 gwLightsVersion;
+    quint64 gwGroupsVersion;
+    QMap<quint64, QString> lightsChanges; // version -> id, last change of each light
+    QMap<quint64, QString> sensorsChanges;
+    QMap<quint64, QString> groupsChanges;
+    QMap<quint64, QString> rulesChanges;
     bool gwRunFromShellScript;
     bool gwDeleteUnknownRules;
     bool groupDeviceMembershipChecked;
@@ -1153,7 +1424,6 @@ public:
     int ccNetworkDisconnectAttempts; // disconnect attemps before chanelchange
     int ccNetworkReconnectAttempts; // reconnect attemps after channelchange
     bool ccNetworkConnectedBefore;
-    uint8_t channelChangeApsRequestId;
 
     // generic network reconnect state machine
     enum networkReconnectState
@@ -1180,7 +1450,6 @@ public:
     ResetDeviceState resetDeviceState;
     uint8_t zdpResetSeq;
     uint64_t lastNodeAddressExt;
-    uint8_t resetDeviceApsRequestId;
 
     // sensors
     enum FindSensorsState
@@ -1261,13 +1530,32 @@ public:
     size_t sensorCheckIter;
     QVector<QString> sensorTypes;
     std::vector<Group> groups;
-    std::vector<LightNode> nodes;
+    SlotMap<LightNode> nodes; // stable addresses, pointers stay valid when new lights are added
     std::vector<Rule> rules;
-    std::vector<Sensor> sensors;
-    std::list<TaskItem> tasks;
-    std::list<TaskItem> runningTasks;
+    SlotMap<Sensor> sensors; // stable addresses, pointers stay valid when new sensors are added
+    DeviceIndex lightIndex; // lookup index over nodes
+    DeviceIndex sensorIndex; // lookup index over sensors
+    GroupIndex groupIndex; // group members and on/reachable counters over nodes
+    PollScheduler pollScheduler; // next poll of light items by node slot
+    std::list<TaskItem> tasks; // storage of queued tasks, scheduled through taskDestinations
+    std::vector<ApsRequestSlot> apsRequests; // in-flight requests indexed by APS request id
+    int runningTaskCount; // slots in apsRequests owned by tasks
+    QHash<TaskDstKey, TaskDestinationQueue> taskDestinations;
+    QHash<TaskDedupeKey, std::list<TaskItem>::iterator> taskDedupe;
+    std::deque<TaskDstKey> taskReady[TaskPriorityMax]; // round robin of destinations with queued tasks per priority
+    TaskPriority taskPriorityContext; // priority of tasks created by the current request
+    TaskWindow taskWindowGlobal; // unconfirmed requests in total
+    QHash<quint64, TaskWindow> taskRouteWindows; // unconfirmed requests via a parent router
+    QHash<quint64, quint64> taskRouteParents; // end device extended address -> parent router
+    QHash<quint16, TokenBucket> groupSendBuckets; // pacing of requests per group
+    TokenBucket broadcastBudget; // broadcasts and groupcasts in the whole network
+    quint32 broadcastsSent;
+    quint32 broadcastsDeferred;
+    quint32 broadcastsDropped;
     QTimer *verifyRulesTimer;
     QTimer *taskTimer;
+    QTimer *readBatchTimer;
+    std::vector<ReadAttributesBatch> readBatches; // attribute reads waiting for READ_BATCH_WINDOW
     QTimer *groupTaskTimer;
     QTimer *checkSensorsTimer;
     uint8_t zclSeq;
@@ -1282,6 +1570,8 @@ public:
     // events
     QTimer *eventTimer;
     std::deque<Event> eventQueue;
+    quint64 eventQueueSeq; // sequence number of the front event
+    QHash<EventKey, quint64> eventIndex; // pending events which can be coalesced -> sequence number
 
     // bindings
     size_t verifyRuleIter;
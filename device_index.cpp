@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "device_index.h"
+#include "rest_node_base.h"
+
+/*! Removes all keys from the index.
+ */
+void DeviceIndex::clear()
+{
+    m_keys.clear();
+    m_ext.clear();
+    m_nwk.clear();
+    m_extEndpoint.clear();
+    m_id.clear();
+    m_uniqueId.clear();
+}
+
+/*! Inserts or refreshes the keys of a device.
+    \param slot - position of the device in its container
+    \param node - the device
+    \param endpoint - the endpoint which identifies the device on its node
+ */
+void DeviceIndex::update(size_t slot, const RestNodeBase &node, quint8 endpoint)
+{
+    if (slot >= m_keys.size())
+    {
+        m_keys.resize(slot + 1);
+    }
+
+    Keys &keys = m_keys[slot];
+
+    if (keys.indexed &&
+        keys.ext == node.address().ext() &&
+        keys.nwk == node.address().nwk() &&
+        keys.endpoint == endpoint &&
+        keys.id == node.id() &&
+        keys.uniqueId == node.uniqueId())
+    {
+        return; // unchanged
+    }
+
+    if (keys.indexed)
+    {
+        removeSlot(m_ext, keys.ext, slot);
+        removeSlot(m_nwk, keys.nwk, slot);
+        removeSlot(m_extEndpoint, ExtEndpoint(keys.ext, keys.endpoint), slot);
+        removeSlot(m_id, keys.id, slot);
+        removeSlot(m_uniqueId, keys.uniqueId, slot);
+    }
+
+    keys.indexed = true;
+    keys.ext = node.address().ext();
+    keys.nwk = node.address().nwk();
+    keys.endpoint = endpoint;
+    keys.id = node.id();
+    keys.uniqueId = node.uniqueId();
+
+    insertSlot(m_ext, keys.ext, slot);
+    insertSlot(m_nwk, keys.nwk, slot);
+    insertSlot(m_extEndpoint, ExtEndpoint(keys.ext, keys.endpoint), slot);
+    insertSlot(m_id, keys.id, slot);
+    insertSlot(m_uniqueId, keys.uniqueId, slot);
+}
+
+/*! Returns the slots of all devices with the extended address \p ext.
+ */
+const std::vector<size_t> &DeviceIndex::slotsForExt(quint64 ext) const
+{
+    return lookup(m_ext, ext);
+}
+
+/*! Returns the slots of all devices with the network address \p nwk.
+ */
+const std::vector<size_t> &DeviceIndex::slotsForNwk(quint16 nwk) const
+{
+    return lookup(m_nwk, nwk);
+}
+
+/*! Returns the slots of all devices with the extended address \p ext on \p endpoint.
+ */
+const std::vector<size_t> &DeviceIndex::slotsForExtAndEndpoint(quint64 ext, quint8 endpoint) const
+{
+    return lookup(m_extEndpoint, ExtEndpoint(ext, endpoint));
+}
+
+/*! Returns the slots of all devices with the REST API \p id.
+ */
+const std::vector<size_t> &DeviceIndex::slotsForId(const QString &id) const
+{
+    return lookup(m_id, id);
+}
+
+/*! Returns the slots of all devices with the unique id \p uniqueId.
+ */
+const std::vector<size_t> &DeviceIndex::slotsForUniqueId(const QString &uniqueId) const
+{
+    return lookup(m_uniqueId, uniqueId);
+}
+
+/*! Adds \p slot to the bucket of \p key while keeping the bucket sorted.
+ */
+template <typename K>
+void DeviceIndex::insertSlot(QHash<K, std::vector<size_t> > &hash, const K &key, size_t slot)
+{
+    std::vector<size_t> &bucket = hash[key];
+    std::vector<size_t>::iterator i = std::lower_bound(bucket.begin(), bucket.end(), slot);
+    if (i == bucket.end() || *i != slot)
+    {
+        bucket.insert(i, slot);
+    }
+}
+
+/*! Removes \p slot from the bucket of \p key, empty buckets are dropped.
+ */
+template <typename K>
+void DeviceIndex::removeSlot(QHash<K, std::vector<size_t> > &hash, const K &key, size_t slot)
+{
+    typename QHash<K, std::vector<size_t> >::iterator h = hash.find(key);
+    if (h == hash.end())
+    {
+        return;
+    }
+
+    std::vector<size_t> &bucket = h.value();
+    std::vector<size_t>::iterator i = std::lower_bound(bucket.begin(), bucket.end(), slot);
+    if (i != bucket.end() && *i == slot)
+    {
+        bucket.erase(i);
+    }
+
+    if (bucket.empty())
+    {
+        hash.erase(h);
+    }
+}
+
+/*! Returns the bucket of \p key or an empty list.
+ */
+template <typename K>
+const std::vector<size_t> &DeviceIndex::lookup(const QHash<K, std::vector<size_t> > &hash, const K &key) const
+{
+    typename QHash<K, std::vector<size_t> >::const_iterator h = hash.constFind(key);
+    if (h != hash.constEnd())
+    {
+        return h.value();
+    }
+    return m_none;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef DEVICE_INDEX_H
+#define DEVICE_INDEX_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <vector>
+
+class RestNodeBase;
+
+/*! \class DeviceIndex
+
+    Hash index over the slots of a device container (lights or sensors).
+
+    Each key maps to the ascending list of slots which carry that key,
+    so lookups return the same element a linear scan would have found first.
+    The index must be refreshed via update() whenever a device is added or
+    its address, id or unique id changes.
+ */
+class DeviceIndex
+{
+public:
+    void clear();
+    void update(size_t slot, const RestNodeBase &node, quint8 endpoint);
+    const std::vector<size_t> &slotsForExt(quint64 ext) const;
+    const std::vector<size_t> &slotsForNwk(quint16 nwk) const;
+    const std::vector<size_t> &slotsForExtAndEndpoint(quint64 ext, quint8 endpoint) const;
+    const std::vector<size_t> &slotsForId(const QString &id) const;
+    const std::vector<size_t> &slotsForUniqueId(const QString &uniqueId) const;
+
+private:
+    typedef QPair<quint64, quint8> ExtEndpoint;
+
+    class Keys
+    {
+    public:
+        Keys() : indexed(false), ext(0), nwk(0), endpoint(0) { }
+        bool indexed;
+        quint64 ext;
+        quint16 nwk;
+        quint8 endpoint;
+        QString id;
+        QString uniqueId;
+    };
+
+    template <typename K>
+    static void insertSlot(QHash<K, std::vector<size_t> > &hash, const K &key, size_t slot);
+    template <typename K>
+    static void removeSlot(QHash<K, std::vector<size_t> > &hash, const K &key, size_t slot);
+    template <typename K>
+    const std::vector<size_t> &lookup(const QHash<K, std::vector<size_t> > &hash, const K &key) const;
+
+    std::vector<Keys> m_keys; // keys under which each slot is currently indexed
+    QHash<quint64, std::vector<size_t> > m_ext;
+    QHash<quint16, std::vector<size_t> > m_nwk;
+    QHash<ExtEndpoint, std::vector<size_t> > m_extEndpoint;
+    QHash<QString, std::vector<size_t> > m_id;
+    QHash<QString, std::vector<size_t> > m_uniqueId;
+    std::vector<size_t> m_none;
+};
+
+#endif // DEVICE_INDEX_H
@@ -5,7 +5,9 @@
  */
 Event::Event() :
     m_resource(0),
-    m_what(0)
+    m_what(0),
+    m_num(0),
+    m_seq(0)
 {
 }
 
@@ -15,7 +17,8 @@ Event::Event(const char *resource, const char *what, const QString &id) :
     m_resource(resource),
     m_what(what),
     m_id(id),
-    m_num(0)
+    m_num(0),
+    m_seq(0)
 {
 }
 
@@ -24,7 +27,15 @@ Event::Event(const char *resource, const char *what, const QString &id) :
 Event::Event(const char *resource, const char *what, int num) :
     m_resource(resource),
     m_what(what),
-    m_num(num)
+    m_num(num),
+    m_seq(0)
 {
 }
 
+/*! Returns true if every change of the item must be published, like a button press,
+    events of these items are never coalesced.
+ */
+bool isTransitionEvent(const char *what)
+{
+    return what == RStateButtonEvent || what == RStatePresence || what == RStateOpen;
+}
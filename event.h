@@ -1,7 +1,10 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <QHash>
 #include <QString>
+#include <QVariant>
+#include "resource.h"
 
 class Event
 {
@@ -14,13 +17,46 @@ public:
     const char *what() const { return m_what; }
     const QString &id() const { return m_id; }
     int num() const { return m_num; }
-
+    const SteadyTimeRef &queueTime() const { return m_queueTime; }
+    void setQueueTime(const SteadyTimeRef &t) { m_queueTime = t; }
+    const QVariant &value() const { return m_value; }
+    void setValue(const QVariant &value) { m_value = value; }
+    quint64 seq() const { return m_seq; }
+    void setSeq(quint64 seq) { m_seq = seq; }
 
 private:
     const char *m_resource;
     const char *m_what;
     QString m_id;
     int m_num;
+    SteadyTimeRef m_queueTime;
+    QVariant m_value; // snapshot of the item when the event was queued
+    quint64 m_seq; // position in the event queue
 };
 
+bool isTransitionEvent(const char *what);
+
+/*! \class EventKey
+
+    Pending events with the same key are coalesced.
+ */
+class EventKey
+{
+public:
+    EventKey(const Event &e) : resource(e.resource()), what(e.what()), id(e.id()), num(e.num()) { }
+    bool operator==(const EventKey &other) const
+    {
+        return resource == other.resource && what == other.what && num == other.num && id == other.id;
+    }
+    const char *resource;
+    const char *what;
+    QString id;
+    int num;
+};
+
+inline uint qHash(const EventKey &key)
+{
+    return qHash(key.id) ^ qHash(quintptr(key.what)) ^ qHash(quintptr(key.resource)) ^ uint(key.num);
+}
+
 #endif // EVENT_H
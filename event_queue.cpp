@@ -2,54 +2,146 @@
 #include "de_web_plugin_private.h"
 #include "json.h"
 
+/*! Returns true if a pending event may be replaced by a newer one with the same key.
+    Only item changes and idempotent checks are coalesced, added and deleted events
+    must keep their order.
+ */
+static bool isCoalescableEvent(const Event &e)
+{
+    if (e.what() == REventCheckGroupAnyOn)
+    {
+        return true;
+    }
+
+    if (strncmp(e.what(), "state/", 6) != 0 && strncmp(e.what(), "config/", 7) != 0)
+    {
+        return false;
+    }
+
+    return !isTransitionEvent(e.what());
+}
+
 /*! Inits the event queue.
  */
 void DeRestPluginPrivate::initEventQueue()
 {
+    eventQueueSeq = 0;
     eventTimer = new QTimer(this);
     eventTimer->setSingleShot(true);
-    eventTimer->setInterval(50);
+    eventTimer->setInterval(EVENT_QUEUE_DELAY);
     connect(eventTimer, SIGNAL(timeout()), this, SLOT(eventQueueTimerFired()));
 }
 
-/*! Handles one event and fires again if more are in the queue.
+/*! Handles queued events until the queue is empty or EVENT_BATCH_BUDGET is used up.
+    Remaining events are handled in the next event loop turn.
  */
 void DeRestPluginPrivate::eventQueueTimerFired()
 {
     DBG_Assert(!eventQueue.empty());
 
-    Event &e = eventQueue.front();
+    QElapsedTimer budget;
+    budget.start();
+
+    while (!eventQueue.empty())
+    {
+        // take the event out first, so that events of the handlers aren't merged into it
+        const Event e = eventQueue.front();
+        eventQueue.pop_front();
+        eventQueueSeq++;
+
+        if (isCoalescableEvent(e))
+        {
+            QHash<EventKey, quint64>::iterator i = eventIndex.find(EventKey(e));
+            if (i != eventIndex.end() && i.value() == e.seq())
+            {
+                eventIndex.erase(i);
+            }
+        }
+
+        perfCounters().eventQueueAge.record(e.queueTime().msecsTo(steadyTimeRef()));
+
+        if (e.resource() == RSensors)
+        {
+            handleSensorEvent(e);
+        }
+        else if (e.resource() == RLights)
+        {
+            handleLightEvent(e);
+        }
+        else if (e.resource() == RGroups)
+        {
+            handleGroupEvent(e);
+        }
+
+        perfCounters().eventsProcessed++;
+
+        if (budget.elapsed() >= EVENT_BATCH_BUDGET)
+        {
+            break;
+        }
+    }
+
+    if (!eventQueue.empty())
+    {
+        eventTimer->start(0); // continue after pending socket and timer events
+    }
+}
+
+/*! Puts an event into the queue.
+    The current value of the item is stored in the event. If an event of the same
+    resource, id and item is still pending it gets the new value instead.
+    \param event - the event
+ */
+void DeRestPluginPrivate::enqueueEvent(const Event &event)
+{
+    Event e(event);
+    Resource *r = 0;
 
     if (e.resource() == RSensors)
     {
-        handleSensorEvent(e);
+        r = getSensorNodeForId(e.id());
     }
     else if (e.resource() == RLights)
     {
-        handleLightEvent(e);
+        r = getLightNodeForId(e.id());
     }
     else if (e.resource() == RGroups)
     {
-        handleGroupEvent(e);
+        r = getGroupForId(e.num());
+    }
+
+    ResourceItem *item = r ? r->item(e.what()) : 0;
+    if (item)
+    {
+        e.setValue(item->toVariant());
     }
 
-    eventQueue.pop_front();
+    e.setQueueTime(steadyTimeRef());
+    e.setSeq(eventQueueSeq + eventQueue.size());
+    PerfCounters &perf = perfCounters();
 
-    if (!eventQueue.empty())
+    if (isCoalescableEvent(e))
     {
-        eventTimer->start();
+        QHash<EventKey, quint64>::iterator i = eventIndex.find(EventKey(e));
+        if (i != eventIndex.end() &&
+            DBG_Assert(i.value() >= eventQueueSeq && i.value() < e.seq()))
+        {
+            Event &pending = eventQueue[i.value() - eventQueueSeq];
+            pending.setValue(e.value()); // keeps its position and queue time
+            perf.eventsCoalesced++;
+            return;
+        }
+
+        eventIndex.insert(EventKey(e), e.seq());
     }
-}
 
-/*! Puts an event into the queue.
-    \param event - the event
- */
-void DeRestPluginPrivate::enqueueEvent(const Event &event)
-{
-    eventQueue.push_back(event);
+    eventQueue.push_back(e);
+
+    perf.eventsQueued++;
+    perf.eventQueueMax = qMax(perf.eventQueueMax, (int)eventQueue.size());
 
     if (!eventTimer->isActive())
     {
-        eventTimer->start();
+        eventTimer->start(EVENT_QUEUE_DELAY);
     }
 }
@@ -21,7 +21,9 @@ Group::Group() :
     m_on(false),
     m_colorLoopActive(false)
 {
-   sendTime = QTime::currentTime();
+   version = 0;
+   jsonVersion = 0;
+   jsonChangeSeq = 0;
    hidden = false;
    hueReal = 0;
    hue = 0;
@@ -33,6 +35,7 @@ Group::Group() :
    colormode = QLatin1String("hs");
 
    // add common items
+    addItem(DataTypeBool, RStateAllOn);
     addItem(DataTypeBool, RStateAnyOn);
 }
 
@@ -63,9 +63,12 @@ public:
     uint16_t level;
     uint16_t colorTemperature;
     QString etag;
+    quint64 version; // bumped with the etag, see DeRestPluginPrivate::updateEtag()
+    QByteArray json; // cached REST API JSON, see DeRestPluginPrivate::groupToJson()
+    quint64 jsonVersion; // version of the cached JSON
+    quint64 jsonChangeSeq; // Resource::changeSeq() of the cached JSON
     QString colormode;
     std::vector<Scene> scenes;
-    QTime sendTime;
     bool hidden;
     std::vector<QString> m_multiDeviceIds;
     std::vector<QString> m_lightsequence;
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "group_index.h"
+#include "light_node.h"
+
+/*! Removes all lights from the index.
+ */
+void GroupIndex::clear()
+{
+    m_members.clear();
+    m_groupMembers.clear();
+    m_counters.clear();
+}
+
+/*! Inserts or refreshes the group memberships and on/reachable state of a light.
+    \param slot - position of the light in its container
+    \param lightNode - the light
+    \param changedGroups - if not 0, receives the groups which the light joined or left
+ */
+void GroupIndex::update(size_t slot, const LightNode &lightNode, std::vector<quint16> *changedGroups)
+{
+    if (slot >= m_members.size())
+    {
+        m_members.resize(slot + 1);
+    }
+
+    Member current;
+    const ResourceItem *item = lightNode.item(RIdStateOn);
+    current.on = item && item->toBool();
+    current.reachable = lightNode.isAvailable();
+
+    std::vector<GroupInfo>::const_iterator i = lightNode.groups().begin();
+    std::vector<GroupInfo>::const_iterator end = lightNode.groups().end();
+
+    for (; i != end; ++i)
+    {
+        if (i->state == GroupInfo::StateInGroup && i->id != 0)
+        {
+            current.groups.push_back(i->id);
+        }
+    }
+
+    std::sort(current.groups.begin(), current.groups.end());
+    current.groups.erase(std::unique(current.groups.begin(), current.groups.end()), current.groups.end());
+
+    Member &indexed = m_members[slot];
+
+    if (indexed.on == current.on &&
+        indexed.reachable == current.reachable &&
+        indexed.groups == current.groups)
+    {
+        return; // unchanged
+    }
+
+    // withdraw the old state
+    for (size_t g = 0; g < indexed.groups.size(); g++)
+    {
+        addContribution(indexed.groups[g], indexed, -1);
+
+        if (!std::binary_search(current.groups.begin(), current.groups.end(), indexed.groups[g]))
+        {
+            QHash<quint16, std::vector<size_t> >::iterator h = m_groupMembers.find(indexed.groups[g]);
+            if (h != m_groupMembers.end())
+            {
+                std::vector<size_t> &bucket = h.value();
+                std::vector<size_t>::iterator s = std::lower_bound(bucket.begin(), bucket.end(), slot);
+                if (s != bucket.end() && *s == slot)
+                {
+                    bucket.erase(s);
+                }
+                if (bucket.empty())
+                {
+                    m_groupMembers.erase(h);
+                }
+            }
+
+            if (changedGroups)
+            {
+                changedGroups->push_back(indexed.groups[g]);
+            }
+        }
+    }
+
+    // apply the new state
+    for (size_t g = 0; g < current.groups.size(); g++)
+    {
+        addContribution(current.groups[g], current, 1);
+
+        std::vector<size_t> &bucket = m_groupMembers[current.groups[g]];
+        std::vector<size_t>::iterator s = std::lower_bound(bucket.begin(), bucket.end(), slot);
+        if (s == bucket.end() || *s != slot)
+        {
+            bucket.insert(s, slot);
+
+            if (changedGroups)
+            {
+                changedGroups->push_back(current.groups[g]);
+            }
+        }
+    }
+
+    indexed = current;
+}
+
+/*! Returns the slots of all lights which are member of the group \p groupId.
+    The global group 0 isn't indexed.
+ */
+const std::vector<size_t> &GroupIndex::members(quint16 groupId) const
+{
+    QHash<quint16, std::vector<size_t> >::const_iterator h = m_groupMembers.constFind(groupId);
+    if (h != m_groupMembers.constEnd())
+    {
+        return h.value();
+    }
+    return m_none;
+}
+
+/*! Returns the on/reachable counters of the group \p groupId.
+ */
+const GroupIndex::Counters &GroupIndex::counters(quint16 groupId) const
+{
+    QHash<quint16, Counters>::const_iterator h = m_counters.constFind(groupId);
+    if (h != m_counters.constEnd())
+    {
+        return h.value();
+    }
+    return m_noCounters;
+}
+
+/*! Adds (\p delta = 1) or withdraws (\p delta = -1) the state of a member light to the group counters.
+ */
+void GroupIndex::addContribution(quint16 groupId, const Member &member, int delta)
+{
+    Counters &c = m_counters[groupId];
+    c.lights += delta;
+    if (member.on) { c.on += delta; }
+    if (member.reachable) { c.reachable += delta; }
+    if (member.on && member.reachable) { c.reachableOn += delta; }
+
+    DBG_Assert(c.lights >= 0);
+    if (c.lights <= 0)
+    {
+        m_counters.remove(groupId);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef GROUP_INDEX_H
+#define GROUP_INDEX_H
+
+#include <QHash>
+#include <vector>
+
+class LightNode;
+
+/*! \class GroupIndex
+
+    Reverse index from group address to the slots of its member lights.
+
+    For each group the number of member lights which are on and reachable
+    is maintained incrementally, so any_on and all_on can be answered without scanning lights.
+    The global group 0 isn't indexed since it contains all lights.
+    The index must be refreshed via update() whenever the group memberships
+    or the on/reachable state of a light changes.
+ */
+class GroupIndex
+{
+public:
+    class Counters
+    {
+    public:
+        Counters() : lights(0), on(0), reachable(0), reachableOn(0) { }
+        bool anyOn() const { return reachableOn > 0; }
+        bool allOn() const { return reachable > 0 && reachableOn == reachable; }
+        int lights; // member lights
+        int on; // member lights which are on
+        int reachable; // member lights which are reachable
+        int reachableOn; // member lights which are reachable and on
+    };
+
+    void clear();
+    void update(size_t slot, const LightNode &lightNode, std::vector<quint16> *changedGroups = 0);
+    const std::vector<size_t> &members(quint16 groupId) const;
+    const Counters &counters(quint16 groupId) const;
+
+private:
+    class Member
+    {
+    public:
+        Member() : on(false), reachable(false) { }
+        std::vector<quint16> groups; // sorted
+        bool on;
+        bool reachable;
+    };
+
+    void addContribution(quint16 groupId, const Member &member, int delta);
+
+    std::vector<Member> m_members; // state under which each light slot is currently indexed
+    QHash<quint16, std::vector<size_t> > m_groupMembers; // group address --> sorted light slots
+    QHash<quint16, Counters> m_counters;
+    std::vector<size_t> m_none;
+    Counters m_noCounters;
+};
+
+#endif // GROUP_INDEX_H
@@ -36,6 +36,10 @@ LightNode::LightNode() :
    m_sceneCapacity(16)
 
 {
+    version = 0;
+    jsonVersion = 0;
+    jsonChangeSeq = 0;
+
     // add common items
     addItem(DataTypeBool, RStateOn);
     addItem(DataTypeString, RStateAlert);
@@ -84,6 +84,10 @@ public:
     void setSceneCapacity(uint8_t sceneCapacity);
 
     QString etag;
+    quint64 version; // bumped with the etag, see DeRestPluginPrivate::updateEtag()
+    QByteArray json; // cached REST API JSON, see DeRestPluginPrivate::lightToJson()
+    quint64 jsonVersion; // version of the cached JSON
+    quint64 jsonChangeSeq; // Resource::changeSeq() of the cached JSON
 
 private:
     State m_state;
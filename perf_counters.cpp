@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "perf_counters.h"
+
+static PerfCounters perfCountersInstance;
+
+/*! Returns the counters of the plugin.
+ */
+PerfCounters &perfCounters()
+{
+    return perfCountersInstance;
+}
+
+/*! Clears all recorded values.
+ */
+void PerfHistogram::reset()
+{
+    count = 0;
+    sum = 0;
+    max = 0;
+
+    for (int i = 0; i < Buckets; i++)
+    {
+        buckets[i] = 0;
+    }
+}
+
+/*! Records a value, negative values are counted as 0.
+ */
+void PerfHistogram::record(qint64 value)
+{
+    if (value < 0)
+    {
+        value = 0;
+    }
+
+    int b = 0;
+    while (b < (Buckets - 1) && upperBound(b) < value)
+    {
+        b++;
+    }
+
+    buckets[b]++;
+    count++;
+    sum += value;
+
+    if (value > max)
+    {
+        max = value;
+    }
+}
+
+/*! Returns the upper bound of a bucket or -1 for the last, unbounded bucket.
+ */
+qint64 PerfHistogram::upperBound(int bucket)
+{
+    if (bucket >= (Buckets - 1))
+    {
+        return -1;
+    }
+
+    return Q_INT64_C(1) << bucket;
+}
+
+/*! Returns an estimate of the \p p-th percentile.
+    The value is the upper bound of the bucket which holds the percentile,
+    but never more than the maximum recorded value.
+ */
+qint64 PerfHistogram::percentile(int p) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const quint64 rank = (count * p + 99) / 100;
+    quint64 n = 0;
+
+    for (int i = 0; i < (Buckets - 1); i++)
+    {
+        n += buckets[i];
+        if (n >= rank)
+        {
+            return qMin(upperBound(i), max);
+        }
+    }
+
+    return max;
+}
+
+/*! Clears all counters.
+ */
+void PerfCounters::reset()
+{
+    resetTime = steadyTimeRef();
+
+    tasksAdded = 0;
+    tasksCoalesced = 0;
+    tasksRejected = 0;
+    tasksDropped = 0;
+    tasksSent = 0;
+    tasksConfirmed = 0;
+    tasksFailed = 0;
+    tasksTimedOut = 0;
+    tasksRunningMax = 0;
+
+    eventsQueued = 0;
+    eventsCoalesced = 0;
+    eventsProcessed = 0;
+    eventQueueMax = 0;
+
+    websocketMessages = 0;
+    websocketDropped = 0;
+    websocketCoalesced = 0;
+    websocketDisconnected = 0;
+
+    apsConfirmLatency.reset();
+    eventQueueAge.reset();
+    dbSaveTime.reset();
+    websocketBroadcastTime.reset();
+    httpRequestTime.clear();
+}
+
+/*! Records the handling time of a REST API request.
+    \param route - the HTTP method and first resource segment of the request
+    \param usecs - the handling time in microseconds
+ */
+void PerfCounters::recordHttpRequest(const QString &route, qint64 usecs)
+{
+    httpRequestTime[route].record(usecs);
+}
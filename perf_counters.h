@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <QMap>
+#include <QString>
+#include "resource.h"
+
+/*! \class PerfHistogram
+
+    Distribution of a measured value in power of two buckets.
+    Bucket i counts values <= 2^i, the last bucket counts all larger values.
+ */
+class PerfHistogram
+{
+public:
+    enum { Buckets = 24 };
+
+    PerfHistogram() { reset(); }
+    void reset();
+    void record(qint64 value);
+    qint64 percentile(int p) const;
+    static qint64 upperBound(int bucket);
+
+    quint64 count;
+    quint64 sum;
+    qint64 max;
+    quint32 buckets[Buckets];
+};
+
+/*! \class PerfCounters
+
+    Runtime counters of the plugin.
+
+    All counters are updated from the main thread only, so they are plain integers
+    without locks or atomics. Gauges like queue lengths are not stored here but
+    read from their containers when the counters are exported.
+ */
+class PerfCounters
+{
+public:
+    PerfCounters() { reset(); }
+    void reset();
+    void recordHttpRequest(const QString &route, qint64 usecs);
+
+    SteadyTimeRef resetTime;
+
+    quint64 tasksAdded;
+    quint64 tasksCoalesced;
+    quint64 tasksRejected;
+    quint64 tasksDropped;
+    quint64 tasksSent;
+    quint64 tasksConfirmed;
+    quint64 tasksFailed;
+    quint64 tasksTimedOut;
+    int tasksRunningMax;
+
+    quint64 eventsQueued;
+    quint64 eventsCoalesced;
+    quint64 eventsProcessed;
+    int eventQueueMax;
+
+    quint64 websocketMessages;
+    quint64 websocketDropped;
+    quint64 websocketCoalesced;
+    quint64 websocketDisconnected;
+
+    PerfHistogram apsConfirmLatency; // ms
+    PerfHistogram eventQueueAge; // ms
+    PerfHistogram dbSaveTime; // ms
+    PerfHistogram websocketBroadcastTime; // us
+    QMap<QString, PerfHistogram> httpRequestTime; // us, key is "<method> <route>"
+};
+
+PerfCounters &perfCounters();
+
+#endif // PERF_COUNTERS_H
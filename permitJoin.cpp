@@ -67,8 +67,8 @@ void DeRestPluginPrivate::permitJoinTimerFired()
         //periodically check if there are deleted lights and undelete them
         if (gwPermitJoinDuration % 10 == 0)
         {
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlotMap<LightNode>::iterator i = nodes.begin();
+            SlotMap<LightNode>::iterator end = nodes.end();
 
             for (; i != end; ++i)
             {
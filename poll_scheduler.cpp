@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "poll_scheduler.h"
+
+/*! Removes all items.
+ */
+void PollScheduler::clear()
+{
+    m_states.clear();
+    m_heap = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> >();
+}
+
+/*! Returns the state of an item or 0 if \p item is out of range.
+ */
+PollScheduler::State *PollScheduler::state(size_t slot, int item)
+{
+    if (item < 0 || item >= MaxItems)
+    {
+        return 0;
+    }
+
+    const size_t idx = slot * MaxItems + item;
+    if (idx >= m_states.size())
+    {
+        m_states.resize((slot + 1) * MaxItems);
+    }
+
+    return &m_states[idx];
+}
+
+/*! Adds a heap entry.
+ */
+void PollScheduler::push(size_t slot, int item, const SteadyTimeRef &due)
+{
+    Entry e;
+    e.due = due;
+    e.slot = slot;
+    e.item = item;
+    m_heap.push(e);
+}
+
+/*! Starts polling an item, does nothing if the item is already scheduled.
+    \param slot - position of the node in its container
+    \param item - index of the item, 0 .. MaxItems - 1
+    \param interval - base interval in seconds
+    \param now - current time, the first poll is due one interval later
+ */
+void PollScheduler::schedule(size_t slot, int item, int interval, const SteadyTimeRef &now)
+{
+    State *st = state(slot, item);
+    if (!st || st->baseInterval != 0)
+    {
+        return;
+    }
+
+    st->baseInterval = interval * 1000;
+    st->due = now.addMSecs(st->baseInterval);
+    push(slot, item, st->due);
+}
+
+/*! Pushes the due time of an item back to one base interval after an attribute report.
+ */
+void PollScheduler::reportReceived(size_t slot, int item, const SteadyTimeRef &now)
+{
+    State *st = state(slot, item);
+    if (!st || st->baseInterval == 0 || !st->due.isValid())
+    {
+        return;
+    }
+
+    st->due = now.addMSecs(st->baseInterval); // the heap entry is moved when it pops
+}
+
+/*! Pops the next item which is due.
+    The caller must reschedule the item with polled() or defer().
+    \return true if an item is due
+ */
+bool PollScheduler::nextDue(const SteadyTimeRef &now, size_t *slot, int *item)
+{
+    while (!m_heap.empty() && m_heap.top().due <= now)
+    {
+        const Entry e = m_heap.top();
+        m_heap.pop();
+
+        State *st = state(e.slot, e.item);
+        if (st->due != e.due)
+        {
+            if (st->due.isValid())
+            {
+                push(e.slot, e.item, st->due); // pushed back by a report
+            }
+            continue;
+        }
+
+        st->due = SteadyTimeRef();
+        *slot = e.slot;
+        *item = e.item;
+        return true;
+    }
+
+    return false;
+}
+
+/*! Reschedules an item one base interval after it was polled.
+ */
+void PollScheduler::polled(size_t slot, int item, const SteadyTimeRef &now)
+{
+    State *st = state(slot, item);
+    if (!st || st->baseInterval == 0)
+    {
+        return;
+    }
+
+    st->due = now.addMSecs(st->baseInterval);
+    push(slot, item, st->due);
+}
+
+/*! Reschedules an item which was returned by nextDue() but not polled.
+ */
+void PollScheduler::defer(size_t slot, int item, const SteadyTimeRef &due)
+{
+    State *st = state(slot, item);
+    if (!st || st->baseInterval == 0)
+    {
+        return;
+    }
+
+    st->due = due;
+    push(slot, item, st->due);
+}
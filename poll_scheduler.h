@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include <functional>
+#include <queue>
+#include <vector>
+#include "resource.h"
+
+/*! \class PollScheduler
+
+    Keeps the next due time of each (node slot, item) pair in a min-heap.
+
+    Each item is polled every base interval as long as the node doesn't report it.
+    A received attribute report moves the due time to one base interval after the report,
+    so an item is polled at the latest one interval after its last report or poll.
+
+    Due times only move later between polls, so the heap holds at most one entry
+    per pair; outdated entries are moved to the current due time when they pop.
+ */
+class PollScheduler
+{
+public:
+    enum { MaxItems = 8 };
+
+    void clear();
+    void schedule(size_t slot, int item, int interval, const SteadyTimeRef &now);
+    void reportReceived(size_t slot, int item, const SteadyTimeRef &now);
+    bool nextDue(const SteadyTimeRef &now, size_t *slot, int *item);
+    void polled(size_t slot, int item, const SteadyTimeRef &now);
+    void defer(size_t slot, int item, const SteadyTimeRef &due);
+
+private:
+    class Entry
+    {
+    public:
+        bool operator>(const Entry &other) const { return due > other.due; }
+        SteadyTimeRef due;
+        size_t slot;
+        int item;
+    };
+
+    class State
+    {
+    public:
+        State() : baseInterval(0) { }
+        SteadyTimeRef due;
+        int baseInterval; // ms, 0 if not scheduled
+    };
+
+    State *state(size_t slot, int item);
+    void push(size_t slot, int item, const SteadyTimeRef &due);
+
+    std::vector<State> m_states; // slot * MaxItems + item
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > m_heap;
+};
+
+#endif // POLL_SCHEDULER_H
@@ -39,8 +39,8 @@ void DeRestPluginPrivate::checkResetState()
         return;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -84,7 +84,7 @@ void DeRestPluginPrivate::checkResetState()
 
                     if (apsCtrl->apsdeDataRequest(req) == deCONZ::Success)
                     {
-                        resetDeviceApsRequestId = req.id();
+                        registerApsRequest(req, ApsOwnerResetDevice);
                         resetDeviceState = ResetWaitConfirm;
                         resetDeviceTimer->start(WAIT_CONFIRM);
                         DBG_Printf(DBG_INFO, "reset device apsdeDataRequest success\n");
@@ -100,8 +100,8 @@ void DeRestPluginPrivate::checkResetState()
         lastNodeAddressExt = 0;
     }
 
-    std::vector<Sensor>::iterator si = sensors.begin();
-    std::vector<Sensor>::iterator si_end = sensors.end();
+    SlotMap<Sensor>::iterator si = sensors.begin();
+    SlotMap<Sensor>::iterator si_end = sensors.end();
 
     for (; si != si_end; ++si)
     {
@@ -151,7 +151,7 @@ void DeRestPluginPrivate::checkResetState()
 
                     if (apsCtrl->apsdeDataRequest(req) == deCONZ::Success)
                     {
-                        resetDeviceApsRequestId = req.id();
+                        registerApsRequest(req, ApsOwnerResetDevice);
                         resetDeviceState = ResetWaitConfirm;
                         resetDeviceTimer->start(WAIT_CONFIRM);
                         DBG_Printf(DBG_INFO, "reset device apsdeDataRequest success\n");
@@ -235,8 +235,8 @@ void DeRestPluginPrivate::handleMgmtLeaveRspIndication(const deCONZ::ApsDataIndi
         if (status == deCONZ::ZdpSuccess || status == deCONZ::ZdpNotSupported)
         {            
             // set retryCount and isAvailable for all endpoints of that device
-            std::vector<LightNode>::iterator i;
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlotMap<LightNode>::iterator i;
+            SlotMap<LightNode>::iterator end = nodes.end();
 
             for (i = nodes.begin(); i != end; ++i)
             {
@@ -248,8 +248,8 @@ void DeRestPluginPrivate::handleMgmtLeaveRspIndication(const deCONZ::ApsDataIndi
                 }
             }
 
-            std::vector<Sensor>::iterator s;
-            std::vector<Sensor>::iterator send = sensors.end();
+            SlotMap<Sensor>::iterator s;
+            SlotMap<Sensor>::iterator send = sensors.end();
 
             for (s = sensors.begin(); s != send; ++s)
             {
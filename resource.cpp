@@ -8,7 +8,13 @@
  *
  */
 
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QString>
+#include <QUuid>
 
 #include "deconz.h"
 #include "resource.h"
@@ -25,6 +31,7 @@ const char *REventCheckGroupAnyOn = "event/checkgroupanyon";
 
 const char *RInvalidSuffix = "invalid/suffix";
 const char *RStateAlert = "state/alert";
+const char *RStateAllOn = "state/all_on";
 const char *RStateAnyOn = "state/any_on";
 const char *RStateButtonEvent = "state/buttonevent";
 const char *RStateBri = "state/bri";
@@ -63,51 +70,189 @@ const char *RConfigSunriseOffset = "config/sunriseoffset";
 const char *RConfigSunsetOffset = "config/sunsetoffset";
 
 static std::vector<const char*> rPrefixes;
-static std::vector<ResourceItemDescriptor> rItemDescriptors;
-static std::vector<QString> rItemStrings; // string allocator: only grows, never shrinks
+static std::vector<ResourceItemDescriptor> rItemDescriptors; // indexed by ResourceSuffixId
+static QHash<const char*, ResourceSuffixId> rSuffixIds; // suffix pointer --> id
+static QElapsedTimer steadyTimer; // monotonic clock
+static SteadyTimeRef steadyNow; // cached per event loop iteration
+static quint64 rItemChangeSeq = 0; // incremented on each ResourceItem value change
+
+/*! Returns the current monotonic time.
+    The value is cached and refreshed by updateSteadyTimeRef() once per event loop iteration,
+    so it is cheap enough to be queried for every ResourceItem::setValue().
+ */
+SteadyTimeRef steadyTimeRef()
+{
+    return steadyNow;
+}
+
+/*! Refreshes the cached monotonic time.
+ */
+void updateSteadyTimeRef()
+{
+    if (!steadyTimer.isValid())
+    {
+        steadyTimer.start();
+    }
+    steadyNow = SteadyTimeRef(steadyTimer.elapsed() + 1); // + 1 since 0 is invalid
+}
+
+/*! Returns a random start value for the version and sequence counters of this run.
+    Unlike the wall clock it doesn't repeat on devices without RTC, so values handed out
+    by earlier runs fall outside the range of this run. 21 random bits leave 2^32 values
+    per run and keep the counters below 2^53, the limit of JSON numbers in JavaScript.
+ */
+quint64 randomCounterEpoch()
+{
+    const QUuid uuid = QUuid::createUuid(); // random (version 4) UUID
+    return quint64(uuid.data1 & 0x1FFFFF) << 32;
+}
+
+/*! A slot of the string arena. */
+class RStringSlot
+{
+public:
+    RStringSlot() : refs(0) { }
+    QString str;
+    quint32 refs; // number of ResourceItems using the slot, 0 marks a free slot
+};
+
+// string arena: equal strings share one reference counted slot, released slots are reused (lowest first);
+// a deque never moves its elements, so references returned by ResourceItem::toString() stay valid
+static std::deque<RStringSlot> rItemStrings; // index 0 holds the invalid (empty) string and is never released
+static std::vector<size_t> rItemStringsFree; // min-heap of free slot indexes
+static QHash<QString, size_t> rItemStringIndex; // interned string --> slot index
+
+/*! Returns the slot index of \p str, the slot's reference count is incremented.
+    Empty strings map to the shared invalid string on index 0.
+ */
+static size_t acquireString(const QString &str)
+{
+    if (str.isEmpty())
+    {
+        return 0;
+    }
+
+    QHash<QString, size_t>::const_iterator i = rItemStringIndex.constFind(str);
+    if (i != rItemStringIndex.constEnd())
+    {
+        rItemStrings[i.value()].refs++;
+        return i.value();
+    }
+
+    size_t idx;
+    if (!rItemStringsFree.empty())
+    {
+        std::pop_heap(rItemStringsFree.begin(), rItemStringsFree.end(), std::greater<size_t>());
+        idx = rItemStringsFree.back();
+        rItemStringsFree.pop_back();
+    }
+    else
+    {
+        idx = rItemStrings.size();
+        rItemStrings.push_back(RStringSlot());
+    }
+
+    rItemStrings[idx].str = str;
+    rItemStrings[idx].refs = 1;
+    rItemStringIndex.insert(str, idx);
+    return idx;
+}
+
+/*! Increments the reference count of the slot \p idx.
+ */
+static void retainString(size_t idx)
+{
+    if (idx > 0 && idx < rItemStrings.size())
+    {
+        DBG_Assert(rItemStrings[idx].refs > 0);
+        rItemStrings[idx].refs++;
+    }
+}
+
+/*! Decrements the reference count of the slot \p idx and frees it when unused.
+ */
+static void releaseString(size_t idx)
+{
+    if (idx == 0 || idx >= rItemStrings.size())
+    {
+        return;
+    }
+
+    RStringSlot &slot = rItemStrings[idx];
+    DBG_Assert(slot.refs > 0);
+    if (slot.refs > 0 && --slot.refs == 0)
+    {
+        rItemStringIndex.remove(slot.str);
+        slot.str = QString(); // free the string data now
+        rItemStringsFree.push_back(idx);
+        std::push_heap(rItemStringsFree.begin(), rItemStringsFree.end(), std::greater<size_t>());
+    }
+}
 
 void initResourceDescriptors()
 {
-    rItemStrings.emplace_back(QString()); // invalid string on index 0
-
-    // init resource lookup
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RStateAlert));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateAnyOn));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt32, RStateButtonEvent));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt8, RStateBri));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RStateColorMode));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RStateCt));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RStateEffect));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RStateHue));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStatePresence));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateOn));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateOpen));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateDark));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateFlag));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RStateLightLevel));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt32, RStateLux));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt32, RStateTemperature));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt32, RStateHumidity));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt32, RStatePressure));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateReachable));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt8, RStateSat));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt32, RStateStatus));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RStateDaylight));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeTime, RStateLastUpdated));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RStateX));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RStateY));
-
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RConfigOn));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RConfigReachable));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeBool, RConfigConfigured));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt8, RConfigBattery, 0, 100));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeUInt16, RConfigDuration));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RConfigGroup));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RConfigUrl));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RConfigLat));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeString, RConfigLong));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt8, RConfigSunriseOffset, -120, 120));
-    rItemDescriptors.emplace_back(ResourceItemDescriptor(DataTypeInt8, RConfigSunsetOffset, -120, 120));
+    updateSteadyTimeRef();
+    if (rItemStrings.empty())
+    {
+        rItemStrings.push_back(RStringSlot()); // invalid string on index 0
+    }
+
+    // init resource lookup, the table is indexed by suffix id
+    rItemDescriptors.resize(RIdMax);
+
+    rItemDescriptors[RIdStateAlert] = ResourceItemDescriptor(DataTypeString, RStateAlert);
+    rItemDescriptors[RIdStateAllOn] = ResourceItemDescriptor(DataTypeBool, RStateAllOn);
+    rItemDescriptors[RIdStateAnyOn] = ResourceItemDescriptor(DataTypeBool, RStateAnyOn);
+    rItemDescriptors[RIdStateButtonEvent] = ResourceItemDescriptor(DataTypeInt32, RStateButtonEvent);
+    rItemDescriptors[RIdStateBri] = ResourceItemDescriptor(DataTypeUInt8, RStateBri);
+    rItemDescriptors[RIdStateColorMode] = ResourceItemDescriptor(DataTypeString, RStateColorMode);
+    rItemDescriptors[RIdStateCt] = ResourceItemDescriptor(DataTypeUInt16, RStateCt);
+    rItemDescriptors[RIdStateEffect] = ResourceItemDescriptor(DataTypeString, RStateEffect);
+    rItemDescriptors[RIdStateHue] = ResourceItemDescriptor(DataTypeUInt16, RStateHue);
+    rItemDescriptors[RIdStatePresence] = ResourceItemDescriptor(DataTypeBool, RStatePresence);
+    rItemDescriptors[RIdStateOn] = ResourceItemDescriptor(DataTypeBool, RStateOn);
+    rItemDescriptors[RIdStateOpen] = ResourceItemDescriptor(DataTypeBool, RStateOpen);
+    rItemDescriptors[RIdStateDark] = ResourceItemDescriptor(DataTypeBool, RStateDark);
+    rItemDescriptors[RIdStateFlag] = ResourceItemDescriptor(DataTypeBool, RStateFlag);
+    rItemDescriptors[RIdStateLightLevel] = ResourceItemDescriptor(DataTypeUInt16, RStateLightLevel);
+    rItemDescriptors[RIdStateLux] = ResourceItemDescriptor(DataTypeUInt32, RStateLux);
+    rItemDescriptors[RIdStateTemperature] = ResourceItemDescriptor(DataTypeInt32, RStateTemperature);
+    rItemDescriptors[RIdStateHumidity] = ResourceItemDescriptor(DataTypeInt32, RStateHumidity);
+    rItemDescriptors[RIdStatePressure] = ResourceItemDescriptor(DataTypeInt32, RStatePressure);
+    rItemDescriptors[RIdStateReachable] = ResourceItemDescriptor(DataTypeBool, RStateReachable);
+    rItemDescriptors[RIdStateSat] = ResourceItemDescriptor(DataTypeUInt8, RStateSat);
+    rItemDescriptors[RIdStateStatus] = ResourceItemDescriptor(DataTypeInt32, RStateStatus);
+    rItemDescriptors[RIdStateDaylight] = ResourceItemDescriptor(DataTypeBool, RStateDaylight);
+    rItemDescriptors[RIdStateLastUpdated] = ResourceItemDescriptor(DataTypeTime, RStateLastUpdated);
+    rItemDescriptors[RIdStateX] = ResourceItemDescriptor(DataTypeUInt16, RStateX);
+    rItemDescriptors[RIdStateY] = ResourceItemDescriptor(DataTypeUInt16, RStateY);
+
+    rItemDescriptors[RIdConfigOn] = ResourceItemDescriptor(DataTypeBool, RConfigOn);
+    rItemDescriptors[RIdConfigReachable] = ResourceItemDescriptor(DataTypeBool, RConfigReachable);
+    rItemDescriptors[RIdConfigConfigured] = ResourceItemDescriptor(DataTypeBool, RConfigConfigured);
+    rItemDescriptors[RIdConfigBattery] = ResourceItemDescriptor(DataTypeUInt8, RConfigBattery, 0, 100);
+    rItemDescriptors[RIdConfigDuration] = ResourceItemDescriptor(DataTypeUInt16, RConfigDuration);
+    rItemDescriptors[RIdConfigGroup] = ResourceItemDescriptor(DataTypeString, RConfigGroup);
+    rItemDescriptors[RIdConfigUrl] = ResourceItemDescriptor(DataTypeString, RConfigUrl);
+    rItemDescriptors[RIdConfigLat] = ResourceItemDescriptor(DataTypeString, RConfigLat);
+    rItemDescriptors[RIdConfigLong] = ResourceItemDescriptor(DataTypeString, RConfigLong);
+    rItemDescriptors[RIdConfigSunriseOffset] = ResourceItemDescriptor(DataTypeInt8, RConfigSunriseOffset, -120, 120);
+    rItemDescriptors[RIdConfigSunsetOffset] = ResourceItemDescriptor(DataTypeInt8, RConfigSunsetOffset, -120, 120);
+
+    for (size_t i = 0; i < rItemDescriptors.size(); i++)
+    {
+        DBG_Assert(rItemDescriptors[i].isValid());
+        rItemDescriptors[i].suffixId = static_cast<ResourceSuffixId>(i);
+        rSuffixIds.insert(rItemDescriptors[i].suffix, rItemDescriptors[i].suffixId);
+    }
+}
+
+/*! Returns the dense id of a resource suffix or RIdInvalid.
+    \param suffix - one of the R* suffix constants (compared by pointer)
+ */
+ResourceSuffixId getResourceSuffixId(const char *suffix)
+{
+    return rSuffixIds.value(suffix, RIdInvalid);
 }
 
 const char *getResourcePrefix(const QString &str)
@@ -136,51 +281,97 @@ bool getResourceItemDescriptor(const QString &str, ResourceItemDescriptor &descr
 ResourceItem::ResourceItem(const ResourceItemDescriptor &rid) :
     m_num(0),
     m_strIndex(0),
-    m_rid(rid)
+    m_strNum(0),
+    m_rid(rid),
+    m_changeSeq(0)
 {
-    if (m_rid.type == DataTypeString ||
-        m_rid.type == DataTypeTime ||
-        m_rid.type == DataTypeTimePattern)
+}
+
+/*! Copy constructor, shares the string slot.
+ */
+ResourceItem::ResourceItem(const ResourceItem &other) :
+    m_num(other.m_num),
+    m_strIndex(other.m_strIndex),
+    m_strNum(other.m_strNum),
+    m_rid(other.m_rid),
+    m_lastSet(other.m_lastSet),
+    m_lastChanged(other.m_lastChanged),
+    m_changeSeq(other.m_changeSeq)
+{
+    retainString(m_strIndex);
+}
+
+/*! Assignment operator, shares the string slot.
+ */
+ResourceItem &ResourceItem::operator=(const ResourceItem &other)
+{
+    if (this != &other)
     {
-        // alloc
-        m_strIndex = rItemStrings.size();
-        rItemStrings.emplace_back(QString());
+        retainString(other.m_strIndex);
+        releaseString(m_strIndex);
+        m_num = other.m_num;
+        m_strIndex = other.m_strIndex;
+        m_strNum = other.m_strNum;
+        m_rid = other.m_rid;
+        m_lastSet = other.m_lastSet;
+        m_lastChanged = other.m_lastChanged;
+        m_changeSeq = other.m_changeSeq;
     }
+    return *this;
+}
+
+/*! Deconstructor, releases the string slot.
+ */
+ResourceItem::~ResourceItem()
+{
+    releaseString(m_strIndex);
 }
 
 const QString &ResourceItem::toString() const
 {
+    DBG_Assert(!rItemStrings.empty());
+
     if (m_rid.type == DataTypeString ||
         m_rid.type == DataTypeTimePattern)
     {
         DBG_Assert(m_strIndex < rItemStrings.size());
         if (m_strIndex < rItemStrings.size())
         {
-            return rItemStrings[m_strIndex];
+            return rItemStrings[m_strIndex].str;
         }
     }
     else if (m_rid.type == DataTypeTime)
     {
-        DBG_Assert(m_strIndex < rItemStrings.size());
-        if (m_strIndex < rItemStrings.size())
+        // the formatted time is cached until m_num changes
+        if (m_strIndex == 0 || m_strNum != m_num)
         {
+            QString str;
             if (m_rid.suffix == RStateLastUpdated)
             {
                 QDateTime dt;
                 dt.setOffsetFromUtc(0);
                 dt.setMSecsSinceEpoch(m_num);
-                rItemStrings[m_strIndex] = dt.toString("yyyy-MM-ddTHH:mm:ss");
+                str = dt.toString("yyyy-MM-ddTHH:mm:ss");
             }
             else
             {
-                rItemStrings[m_strIndex] = QDateTime::fromMSecsSinceEpoch(m_num).toString("yyyy-MM-ddTHH:mm:ss");
+                str = QDateTime::fromMSecsSinceEpoch(m_num).toString("yyyy-MM-ddTHH:mm:ss");
             }
-            return rItemStrings[m_strIndex];
+
+            size_t idx = acquireString(str);
+            releaseString(m_strIndex);
+            m_strIndex = idx;
+            m_strNum = m_num;
+        }
+
+        DBG_Assert(m_strIndex < rItemStrings.size());
+        if (m_strIndex < rItemStrings.size())
+        {
+            return rItemStrings[m_strIndex].str;
         }
     }
 
-    DBG_Assert(!rItemStrings.empty());
-    return rItemStrings[0]; // invalid string
+    return rItemStrings[0].str; // invalid string
 }
 
 qint64 ResourceItem::toNumber() const
@@ -195,14 +386,23 @@ bool ResourceItem::toBool() const
 
 bool ResourceItem::setValue(const QString &val)
 {
+    if (m_rid.type != DataTypeString &&
+        m_rid.type != DataTypeTimePattern)
+    {
+        return setValue(QVariant(val)); // parse time and numeric values
+    }
+
     DBG_Assert(m_strIndex < rItemStrings.size());
     if (m_strIndex < rItemStrings.size())
     {
-        m_lastSet = QDateTime::currentDateTime();
-        if (rItemStrings[m_strIndex] != val)
+        m_lastSet = steadyTimeRef();
+        if (rItemStrings[m_strIndex].str != val)
         {
-            rItemStrings[m_strIndex] = val;
+            size_t idx = acquireString(val);
+            releaseString(m_strIndex);
+            m_strIndex = idx;
             m_lastChanged = m_lastSet;
+            m_changeSeq = ++rItemChangeSeq;
         }
         return true;
     }
@@ -221,12 +421,13 @@ bool ResourceItem::setValue(qint64 val)
         }
     }
 
-    m_lastSet = QDateTime::currentDateTime();
+    m_lastSet = steadyTimeRef();
 
     if (m_num != val)
     {
         m_num = val;
         m_lastChanged = m_lastSet;
+        m_changeSeq = ++rItemChangeSeq;
     }
 
     return true;
@@ -234,7 +435,7 @@ bool ResourceItem::setValue(qint64 val)
 
 bool ResourceItem::setValue(const QVariant &val)
 {
-    QDateTime now = QDateTime::currentDateTime();
+    const SteadyTimeRef now = steadyTimeRef();
 
     if (m_rid.type == DataTypeString ||
         m_rid.type == DataTypeTimePattern)
@@ -243,11 +444,15 @@ bool ResourceItem::setValue(const QVariant &val)
         DBG_Assert(m_strIndex < rItemStrings.size());
         if (m_strIndex < rItemStrings.size())
         {
+            const QString str = val.toString();
             m_lastSet = now;
-            if (rItemStrings[m_strIndex] != val.toString())
+            if (rItemStrings[m_strIndex].str != str)
             {
-                rItemStrings[m_strIndex] = val.toString();
+                size_t idx = acquireString(str);
+                releaseString(m_strIndex);
+                m_strIndex = idx;
                 m_lastChanged = m_lastSet;
+                m_changeSeq = ++rItemChangeSeq;
             }
             return true;
         }
@@ -259,6 +464,7 @@ bool ResourceItem::setValue(const QVariant &val)
         {
             m_num = val.toBool();
             m_lastChanged = m_lastSet;
+            m_changeSeq = ++rItemChangeSeq;
         }
         return true;
     }
@@ -275,6 +481,7 @@ bool ResourceItem::setValue(const QVariant &val)
                 {
                     m_num = dt.toMSecsSinceEpoch();
                     m_lastChanged = m_lastSet;
+                    m_changeSeq = ++rItemChangeSeq;
                 }
                 return true;
             }
@@ -286,6 +493,7 @@ bool ResourceItem::setValue(const QVariant &val)
             {
                 m_num = val.toDateTime().toMSecsSinceEpoch();
                 m_lastChanged = m_lastSet;
+                m_changeSeq = ++rItemChangeSeq;
             }
             return true;
         }
@@ -310,6 +518,7 @@ bool ResourceItem::setValue(const QVariant &val)
             {
                 m_num = n;
                 m_lastChanged = m_lastSet;
+                m_changeSeq = ++rItemChangeSeq;
             }
             return true;
         }
@@ -323,12 +532,12 @@ const ResourceItemDescriptor &ResourceItem::descriptor() const
     return m_rid;
 }
 
-const QDateTime &ResourceItem::lastSet() const
+const SteadyTimeRef &ResourceItem::lastSet() const
 {
     return m_lastSet;
 }
 
-const QDateTime &ResourceItem::lastChanged() const
+const SteadyTimeRef &ResourceItem::lastChanged() const
 {
     return m_lastChanged;
 }
@@ -341,7 +550,7 @@ QVariant ResourceItem::toVariant() const
         DBG_Assert(m_strIndex < rItemStrings.size());
         if (m_strIndex < rItemStrings.size())
         {
-            return rItemStrings[m_strIndex];
+            return rItemStrings[m_strIndex].str;
         }
         return QString();
     }
@@ -361,9 +570,22 @@ QVariant ResourceItem::toVariant() const
     return QVariant();
 }
 
+Resource::Resource() :
+    m_prefix(0)
+{
+    for (int i = 0; i < RIdMax; i++)
+    {
+        m_itemIndex[i] = -1;
+    }
+}
+
 Resource::Resource(const char *prefix) :
     m_prefix(prefix)
 {
+    for (int i = 0; i < RIdMax; i++)
+    {
+        m_itemIndex[i] = -1;
+    }
 }
 
 const char *Resource::prefix() const
@@ -376,16 +598,14 @@ ResourceItem *Resource::addItem(ApiDataType type, const char *suffix)
     ResourceItem *it = item(suffix);
     if (!it) // prevent double insertion
     {
-        std::vector<ResourceItemDescriptor>::const_iterator i = rItemDescriptors.begin();
-        std::vector<ResourceItemDescriptor>::const_iterator end = rItemDescriptors.end();
+        ResourceSuffixId id = getResourceSuffixId(suffix);
 
-        for (; i != end; ++i)
+        if (id != RIdInvalid && rItemDescriptors[id].type == type)
         {
-            if (i->suffix == suffix && i->type == type)
-            {
-                m_rItems.emplace_back(ResourceItem(*i));
-                return &m_rItems.back();
-            }
+            DBG_Assert(m_rItems.size() < 127);
+            m_itemIndex[id] = m_rItems.size();
+            m_rItems.emplace_back(ResourceItem(rItemDescriptors[id]));
+            return &m_rItems.back();
         }
 
         DBG_Assert(0);
@@ -397,33 +617,32 @@ ResourceItem *Resource::addItem(ApiDataType type, const char *suffix)
 
 ResourceItem *Resource::item(const char *suffix)
 {
-    for (size_t i = 0; i < m_rItems.size(); i++)
-    {
-        if (m_rItems[i].descriptor().suffix == suffix)
-        {
-            return &m_rItems[i];
-        }
-    }
-
-    return 0;
+    return item(getResourceSuffixId(suffix));
 }
 
 const ResourceItem *Resource::item(const char *suffix) const
 {
-    for (size_t i = 0; i < m_rItems.size(); i++)
-    {
-        if (m_rItems[i].descriptor().suffix == suffix)
-        {
-            return &m_rItems[i];
-        }
-    }
-
-    return 0;
+    return item(getResourceSuffixId(suffix));
 }
 
 bool Resource::toBool(const char *suffix) const
 {
-    const ResourceItem *i = item(suffix);
+    return toBool(getResourceSuffixId(suffix));
+}
+
+qint64 Resource::toNumber(const char *suffix) const
+{
+    return toNumber(getResourceSuffixId(suffix));
+}
+
+const QString &Resource::toString(const char *suffix) const
+{
+    return toString(getResourceSuffixId(suffix));
+}
+
+bool Resource::toBool(ResourceSuffixId id) const
+{
+    const ResourceItem *i = item(id);
     if (i)
     {
         return i->toBool();
@@ -431,9 +650,9 @@ bool Resource::toBool(const char *suffix) const
     return false;
 }
 
-qint64 Resource::toNumber(const char *suffix) const
+qint64 Resource::toNumber(ResourceSuffixId id) const
 {
-    const ResourceItem *i = item(suffix);
+    const ResourceItem *i = item(id);
     if (i)
     {
         return i->toNumber();
@@ -441,16 +660,16 @@ qint64 Resource::toNumber(const char *suffix) const
     return 0;
 }
 
-const QString &Resource::toString(const char *suffix) const
+const QString &Resource::toString(ResourceSuffixId id) const
 {
-    const ResourceItem *i = item(suffix);
+    const ResourceItem *i = item(id);
     if (i)
     {
         return i->toString();
     }
 
     DBG_Assert(!rItemStrings.empty());
-    return rItemStrings[0]; // invalid string
+    return rItemStrings[0].str; // invalid string
 }
 
 int Resource::itemCount() const
@@ -475,3 +694,16 @@ const ResourceItem *Resource::itemForIndex(size_t idx) const
     }
     return 0;
 }
+
+/*! Returns the sequence number of the latest value change of any item.
+    Cached data derived from the items is outdated when this number changed.
+ */
+quint64 Resource::changeSeq() const
+{
+    quint64 seq = 0;
+    for (size_t i = 0; i < m_rItems.size(); i++)
+    {
+        seq = qMax(seq, m_rItems[i].changeSeq());
+    }
+    return seq;
+}
@@ -38,6 +38,7 @@ extern const char *REventCheckGroupAnyOn;
 // resouce suffixes: state/buttonevent, config/on, ...
 extern const char *RInvalidSuffix;
 extern const char *RStateAlert;
+extern const char *RStateAllOn;
 extern const char *RStateAnyOn;
 extern const char *RStateButtonEvent;
 extern const char *RStateBri;
@@ -75,32 +76,109 @@ extern const char *RConfigLong;
 extern const char *RConfigSunriseOffset;
 extern const char *RConfigSunsetOffset;
 
+// dense resource suffix ids, index into the descriptor table
+enum ResourceSuffixId
+{
+    RIdInvalid = -1,
+    RIdStateAlert,
+    RIdStateAllOn,
+    RIdStateAnyOn,
+    RIdStateButtonEvent,
+    RIdStateBri,
+    RIdStateColorMode,
+    RIdStateCt,
+    RIdStateEffect,
+    RIdStateHue,
+    RIdStatePresence,
+    RIdStateOn,
+    RIdStateOpen,
+    RIdStateDark,
+    RIdStateFlag,
+    RIdStateLightLevel,
+    RIdStateLux,
+    RIdStateTemperature,
+    RIdStateHumidity,
+    RIdStatePressure,
+    RIdStateReachable,
+    RIdStateSat,
+    RIdStateStatus,
+    RIdStateDaylight,
+    RIdStateLastUpdated,
+    RIdStateX,
+    RIdStateY,
+    RIdConfigOn,
+    RIdConfigReachable,
+    RIdConfigConfigured,
+    RIdConfigBattery,
+    RIdConfigDuration,
+    RIdConfigGroup,
+    RIdConfigUrl,
+    RIdConfigLat,
+    RIdConfigLong,
+    RIdConfigSunriseOffset,
+    RIdConfigSunsetOffset,
+    RIdMax
+};
+
 class  ResourceItemDescriptor
 {
 public:
     ResourceItemDescriptor() :
         type(DataTypeUnknown),
         suffix(RInvalidSuffix),
+        suffixId(RIdInvalid),
         validMin(0),
         validMax(0) { }
 
     ResourceItemDescriptor(ApiDataType t, const char *s, int min = 0, int max = 0) :
         type(t),
         suffix(s),
+        suffixId(RIdInvalid),
         validMin(min),
         validMax(max) { }
 
     bool isValid() const { return (type != DataTypeUnknown && suffix); }
     ApiDataType type;
     const char *suffix;
+    ResourceSuffixId suffixId; // set by initResourceDescriptors()
     int validMin;
     int validMax;
 };
 
+/*! \class SteadyTimeRef
+
+    Timestamp in milliseconds on a monotonic clock, unaffected by wall clock jumps.
+ */
+class SteadyTimeRef
+{
+public:
+    SteadyTimeRef() : ref(0) { }
+    explicit SteadyTimeRef(qint64 r) : ref(r) { }
+    bool isValid() const { return ref > 0; }
+    SteadyTimeRef addMSecs(qint64 ms) const { return SteadyTimeRef(ref + ms); }
+    SteadyTimeRef addSecs(qint64 s) const { return SteadyTimeRef(ref + s * 1000); }
+    qint64 msecsTo(const SteadyTimeRef &other) const { return other.ref - ref; }
+    qint64 secsTo(const SteadyTimeRef &other) const { return (other.ref - ref) / 1000; }
+    bool operator==(const SteadyTimeRef &other) const { return ref == other.ref; }
+    bool operator!=(const SteadyTimeRef &other) const { return ref != other.ref; }
+    bool operator<(const SteadyTimeRef &other) const { return ref < other.ref; }
+    bool operator<=(const SteadyTimeRef &other) const { return ref <= other.ref; }
+    bool operator>(const SteadyTimeRef &other) const { return ref > other.ref; }
+    bool operator>=(const SteadyTimeRef &other) const { return ref >= other.ref; }
+    qint64 ref; // 0 means invalid
+};
+
+SteadyTimeRef steadyTimeRef();
+void updateSteadyTimeRef();
+quint64 randomCounterEpoch();
+
 class ResourceItem
 {
 public:
     ResourceItem(const ResourceItemDescriptor &rid);
+    ResourceItem(const ResourceItem &other);
+    ResourceItem &operator=(const ResourceItem &other);
+    ~ResourceItem();
     const QString &toString() const;
     qint64 toNumber() const;
     bool toBool() const;
@@ -109,18 +187,21 @@ public:
     bool setValue(qint64 val);
     bool setValue(const QVariant &val);
     const ResourceItemDescriptor &descriptor() const;
-    const QDateTime &lastSet() const;
-    const QDateTime &lastChanged() const;
+    const SteadyTimeRef &lastSet() const;
+    const SteadyTimeRef &lastChanged() const;
+    quint64 changeSeq() const { return m_changeSeq; }
 
 private:
     ResourceItem() :
-        m_num(-1), m_strIndex(0) {}
+        m_num(-1), m_strIndex(0), m_strNum(0), m_changeSeq(0) {}
 
     qint64 m_num;
-    size_t m_strIndex;
+    mutable size_t m_strIndex; // slot in the string arena, for time types it caches the formatted m_num
+    mutable qint64 m_strNum; // m_num the cached time string was formatted from
     ResourceItemDescriptor m_rid;
-    QDateTime m_lastSet;
-    QDateTime m_lastChanged;
+    SteadyTimeRef m_lastSet;
+    SteadyTimeRef m_lastChanged;
+    quint64 m_changeSeq; // global sequence number of the last value change
 };
 
 class Resource
@@ -134,17 +215,32 @@ public:
     bool toBool(const char *suffix) const;
     qint64 toNumber(const char *suffix) const;
     const QString &toString(const char *suffix) const;
+    // fast path overloads for suffixes known at compile time
+    ResourceItem *item(ResourceSuffixId id)
+    {
+        return (id > RIdInvalid && id < RIdMax && m_itemIndex[id] >= 0) ? &m_rItems[m_itemIndex[id]] : 0;
+    }
+    const ResourceItem *item(ResourceSuffixId id) const
+    {
+        return (id > RIdInvalid && id < RIdMax && m_itemIndex[id] >= 0) ? &m_rItems[m_itemIndex[id]] : 0;
+    }
+    bool toBool(ResourceSuffixId id) const;
+    qint64 toNumber(ResourceSuffixId id) const;
+    const QString &toString(ResourceSuffixId id) const;
     int itemCount() const;
     ResourceItem *itemForIndex(size_t idx);
     const ResourceItem *itemForIndex(size_t idx) const;
+    quint64 changeSeq() const;
 
 private:
-    Resource() {}
+    Resource();
     const char *m_prefix;
     std::vector<ResourceItem> m_rItems;
+    qint8 m_itemIndex[RIdMax]; // suffix id --> index in m_rItems or -1
 };
 
 void initResourceDescriptors();
+ResourceSuffixId getResourceSuffixId(const char *suffix);
 const char *getResourcePrefix(const QString &str);
 bool getResourceItemDescriptor(const QString &str, ResourceItemDescriptor &descr);
 
@@ -57,6 +57,26 @@ int DeRestPluginPrivate::handleConfigurationApi(const ApiRequest &req, ApiRespon
     {
         return getWifiState(req, rsp);
     }
+    // GET /api/<apikey>/config/tasks
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "tasks"))
+    {
+        return getTaskState(req, rsp);
+    }
+    // GET /api/<apikey>/config/perf
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "perf"))
+    {
+        return getPerfCounters(req, rsp);
+    }
+    // GET /api/<apikey>/config/perf/metrics
+    else if ((req.path.size() == 5) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "perf") && (req.path[4] == "metrics"))
+    {
+        return getPerfMetrics(req, rsp);
+    }
+    // DELETE /api/<apikey>/config/perf
+    else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE") && (req.path[2] == "config") && (req.path[3] == "perf"))
+    {
+        return resetPerfCounters(req, rsp);
+    }
     // PUT /api/<apikey>/config/wifi/restore
     else if ((req.path.size() == 5) && (req.hdr.method() == "PUT") && (req.path[2] == "config") && (req.path[3] == "wifi") && (req.path[4] == "restore"))
     {
@@ -169,16 +189,9 @@ int DeRestPluginPrivate::createUser(const ApiRequest &req, ApiResponse &rsp)
         auth.apikey = map["username"].toString();
 
         // check if this apikey is already known
-        std::vector<ApiAuth>::const_iterator i = apiAuths.begin();
-        std::vector<ApiAuth>::const_iterator end = apiAuths.end();
-
-        for (; i != end; ++i)
+        if (getApiAuthForKey(auth.apikey))
         {
-            if (auth.apikey == i->apikey && i->state == ApiAuth::StateNormal)
-            {
-                found = true;
-                break;
-            }
+            found = true;
         }
     }
     else
@@ -226,6 +239,7 @@ int DeRestPluginPrivate::createUser(const ApiRequest &req, ApiResponse &rsp)
         auth.lastUseDate = QDateTime::currentDateTimeUtc();
         auth.needSaveDatabase = true;
         apiAuths.push_back(auth);
+        indexApiAuth(apiAuths.size() - 1);
         queSaveDb(DB_AUTH, DB_SHORT_SAVE_DELAY);
         updateEtag(gwConfigEtag);
         DBG_Printf(DBG_INFO, "created username: %s, devicetype: %s\n", qPrintable(auth.apikey), qPrintable(auth.devicetype));
@@ -451,6 +465,7 @@ void DeRestPluginPrivate::configToMap(const ApiRequest &req, QVariantMap &map)
     map["linkbutton"] = gwLinkButton;
     map["portalservices"] = false;
     map["websocketport"] = (double)webSocketServer->port();
+    map["websocketpolicy"] = WebSocketServer::policyToString(webSocketServer->slowClientPolicy());
 
     gwIpAddress = map["ipaddress"].toString(); // cache
 
@@ -519,6 +534,13 @@ void DeRestPluginPrivate::basicConfigToMap(QVariantMap &map)
 }
 
 /*! GET /api/<apikey>
+    GET /api/<apikey>?since=<version>
+
+    With since the lights, groups, sensors and rules only contain the changes after
+    the version as { "full": false, "changed": { ... }, "deleted": [ ... ] } and "version" is the
+    version to pass in the next request. Start with since=0 to get everything.
+    If since isn't from this run (e.g. after a restart) each part holds all resources
+    with "full": true and replaces the client state instead of being merged.
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
  */
@@ -544,56 +566,8 @@ int DeRestPluginPrivate::getFullState(const ApiRequest &req, ApiResponse &rsp)
         }
     }
 
-    QVariantMap lightsMap;
-    QVariantMap groupsMap;
     QVariantMap configMap;
     QVariantMap schedulesMap;
-    QVariantMap sensorsMap;
-    QVariantMap rulesMap;
-
-    // lights
-    {
-        std::vector<LightNode>::const_iterator i = nodes.begin();
-        std::vector<LightNode>::const_iterator end = nodes.end();
-
-        for (; i != end; ++i)
-        {
-            if (i->state() == LightNode::StateDeleted)
-            {
-                continue;
-            }
-
-            QVariantMap map;
-            if (lightToMap(req, &(*i), map))
-            {
-                lightsMap[i->id()] = map;
-            }
-        }
-    }
-
-    // groups
-    {
-        std::vector<Group>::const_iterator i = groups.begin();
-        std::vector<Group>::const_iterator end = groups.end();
-
-        for (; i != end; ++i)
-        {
-            // ignore deleted groups
-            if (i->state() == Group::StateDeleted || i->state() == Group::StateDeleteFromDB)
-            {
-                continue;
-            }
-
-            if (i->id() != "0")
-            {
-                QVariantMap map;
-                if (groupToMap(&(*i), map))
-                {
-                    groupsMap[i->id()] = map;
-                }
-            }
-        }
-    }
 
     // schedules
     {
@@ -610,52 +584,33 @@ int DeRestPluginPrivate::getFullState(const ApiRequest &req, ApiResponse &rsp)
         }
     }
 
-    // sensors
-    {
-        std::vector<Sensor>::const_iterator i = sensors.begin();
-        std::vector<Sensor>::const_iterator end = sensors.end();
-
-        for (; i != end; ++i)
-        {
-            if (i->deletedState() == Sensor::StateDeleted)
-            {
-                continue;
-            }
-            QVariantMap map;
-            if (sensorToMap(&(*i), map))
-            {
-                sensorsMap[i->id()] = map;
-            }
-        }
-    }
-
-    // rules
-    {
-        std::vector<Rule>::const_iterator i = rules.begin();
-        std::vector<Rule>::const_iterator end = rules.end();
-
-        for (; i != end; ++i)
-        {
-            if (i->state() == Rule::StateDeleted)
-            {
-                continue;
-            }
-            QVariantMap map;
-            if (ruleToMap(&(*i), map))
-            {
-                rulesMap[i->id()] = map;
-            }
-        }
-    }
-
     configToMap(req, configMap);
 
-    rsp.map["lights"] = lightsMap;
-    rsp.map["groups"] = groupsMap;
-    rsp.map["config"] = configMap;
-    rsp.map["schedules"] = schedulesMap;
-    rsp.map["sensors"] = sensorsMap;
-    rsp.map["rules"] = rulesMap;
+    // a delta request gets only the changed lights, groups, sensors and rules
+    quint64 since = 0;
+    const bool delta = sinceVersion(req, &since);
+
+    // lights, groups, sensors and rules are assembled from their cached JSON
+    QByteArray json("{\"config\":");
+    json += Json::serialize(configMap);
+    json += ",\"groups\":";
+    json += delta ? groupsDeltaToJson(since) : groupsToJson();
+    json += ",\"lights\":";
+    json += delta ? lightsDeltaToJson(req, since) : lightsToJson(req);
+    json += ",\"rules\":";
+    json += delta ? rulesDeltaToJson(since) : rulesToJson();
+    json += ",\"schedules\":";
+    json += Json::serialize(schedulesMap);
+    json += ",\"sensors\":";
+    json += delta ? sensorsDeltaToJson(since) : sensorsToJson();
+    if (delta)
+    {
+        json += ",\"version\":";
+        json += QByteArray::number(etagVersion);
+    }
+    json += '}';
+
+    rsp.str = QString::fromUtf8(json);
     rsp.etag = gwConfigEtag;
     rsp.httpStatus = HttpStatusOk;
     return REQ_READY_SEND;
@@ -919,6 +874,30 @@ int DeRestPluginPrivate::modifyConfig(const ApiRequest &req, ApiResponse &rsp)
         rsp.list.append(rspItem);
     }
 
+    if (map.contains("websocketpolicy")) // optional
+    {
+        WebSocketServer::SlowClientPolicy policy;
+        if (!WebSocketServer::policyFromString(map["websocketpolicy"].toString(), &policy))
+        {
+            rsp.list.append(errorToMap(ERR_INVALID_VALUE, QString("/config/websocketpolicy"), QString("invalid value, %1, for parameter, websocketpolicy").arg(map["websocketpolicy"].toString())));
+            rsp.httpStatus = HttpStatusBadRequest;
+            return REQ_READY_SEND;
+        }
+
+        if (webSocketServer->slowClientPolicy() != policy)
+        {
+            webSocketServer->setSlowClientPolicy(policy);
+            queSaveDb(DB_CONFIG, DB_SHORT_SAVE_DELAY);
+            changed = true;
+        }
+
+        QVariantMap rspItem;
+        QVariantMap rspItemState;
+        rspItemState["/config/websocketpolicy"] = map["websocketpolicy"].toString();
+        rspItem["success"] = rspItemState;
+        rsp.list.append(rspItem);
+    }
+
     if (map.contains("rgbwdisplay")) // optional
     {
         QString rgbwDisplay = map["rgbwdisplay"].toString();
@@ -1668,24 +1647,21 @@ int DeRestPluginPrivate::deleteUser(const ApiRequest &req, ApiResponse &rsp)
 
     QString username2 = req.path[4];
 
-    std::vector<ApiAuth>::iterator i = apiAuths.begin();
-    std::vector<ApiAuth>::iterator end = apiAuths.end();
+    ApiAuth *auth = getApiAuthForKey(username2);
 
-    for (; i != end; ++i)
+    if (auth)
     {
-        if (username2 == i->apikey && i->state == ApiAuth::StateNormal)
-        {
-            i->needSaveDatabase = true;
-            i->state = ApiAuth::StateDeleted;
-            queSaveDb(DB_AUTH, DB_LONG_SAVE_DELAY);
+        auth->needSaveDatabase = true;
+        auth->state = ApiAuth::StateDeleted;
+        indexApiAuth(auth - &apiAuths[0]);
+        queSaveDb(DB_AUTH, DB_LONG_SAVE_DELAY);
 
-            QVariantMap rspItem;
-            rspItem["success"] = QString("/config/whitelist/%1 deleted.").arg(username2);
-            rsp.list.append(rspItem);
-            rsp.httpStatus = HttpStatusOk;
+        QVariantMap rspItem;
+        rspItem["success"] = QString("/config/whitelist/%1 deleted.").arg(username2);
+        rsp.list.append(rspItem);
+        rsp.httpStatus = HttpStatusOk;
 
-            return REQ_READY_SEND;
-        }
+        return REQ_READY_SEND;
     }
 
     rsp.str = "[]"; // empty
@@ -1875,8 +1851,8 @@ int DeRestPluginPrivate::resetConfig(const ApiRequest &req, ApiResponse &rsp)
             {
                 if (g->state() != Group::StateDeleted && g->state() != Group::StateDeleteFromDB)
                 {
-                    std::vector<LightNode>::iterator i = nodes.begin();
-                    std::vector<LightNode>::iterator end = nodes.end();
+                    SlotMap<LightNode>::iterator i = nodes.begin();
+                    SlotMap<LightNode>::iterator end = nodes.end();
 
                     for (; i != end; ++i)
                     {
@@ -1887,6 +1863,7 @@ int DeRestPluginPrivate::resetConfig(const ApiRequest &req, ApiResponse &rsp)
                             groupInfo->actions &= ~GroupInfo::ActionAddToGroup; // sanity
                             groupInfo->actions |= GroupInfo::ActionRemoveFromGroup;
                             groupInfo->state = GroupInfo::StateNotInGroup;
+                            indexLightGroups(&*i);
                         }
                     }
                 }
@@ -2145,6 +2122,321 @@ int DeRestPluginPrivate::getWifiState(const ApiRequest &req, ApiResponse &rsp)
     return REQ_READY_SEND;
 }
 
+/*! Puts the state of a task window in a map.
+ */
+static QVariantMap taskWindowToMap(const TaskWindow &w)
+{
+    QVariantMap map;
+    map["window"] = w.window;
+    map["onair"] = (double)w.onAir;
+    map["rtt"] = (double)w.srtt;
+    map["timeout"] = (double)w.timeout();
+    map["confirms"] = (double)w.confirms;
+    map["errors"] = (double)w.errors;
+    map["timeouts"] = (double)w.timeouts;
+    return map;
+}
+
+/*! GET /api/<apikey>/config/tasks
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getTaskState(const ApiRequest &req, ApiResponse &rsp)
+{
+    if(!checkApikeyAuthentification(req, rsp))
+    {
+        return REQ_READY_SEND;
+    }
+
+    QVariantMap destinations;
+    QHash<TaskDstKey, TaskDestinationQueue>::const_iterator d = taskDestinations.constBegin();
+    QHash<TaskDstKey, TaskDestinationQueue>::const_iterator dend = taskDestinations.constEnd();
+
+    for (; d != dend; ++d)
+    {
+        QString id;
+        if (d.key().mode == deCONZ::ApsGroupAddress)
+        {
+            id.sprintf("group/0x%04X", (quint16)d.key().addr);
+        }
+        else if (d.key().mode == deCONZ::ApsExtAddress)
+        {
+            id.sprintf("0x%016llX", (unsigned long long)d.key().addr);
+        }
+        else
+        {
+            id.sprintf("nwk/0x%04X", (quint16)d.key().addr);
+        }
+
+        QVariantMap map = taskWindowToMap(d->window);
+        map["queued"] = (double)d->queued();
+        destinations[id] = map;
+    }
+
+    QVariantMap routes;
+    QHash<quint64, TaskWindow>::const_iterator r = taskRouteWindows.constBegin();
+    QHash<quint64, TaskWindow>::const_iterator rend = taskRouteWindows.constEnd();
+
+    for (; r != rend; ++r)
+    {
+        QString id;
+        id.sprintf("0x%016llX", (unsigned long long)r.key());
+        routes[id] = taskWindowToMap(r.value());
+    }
+
+    rsp.map["queued"] = (double)tasks.size();
+    rsp.map["running"] = (double)runningTaskCount;
+    rsp.map["global"] = taskWindowToMap(taskWindowGlobal);
+
+    QVariantMap broadcast;
+    broadcastBudget.isAvailable(steadyTimeRef()); // refill
+    broadcast["budget"] = (double)BROADCAST_BUDGET;
+    broadcast["window"] = (double)BROADCAST_BUDGET_WINDOW;
+    broadcast["available"] = floor(broadcastBudget.tokens);
+    broadcast["sent"] = (double)broadcastsSent;
+    broadcast["deferred"] = (double)broadcastsDeferred;
+    broadcast["dropped"] = (double)broadcastsDropped;
+    rsp.map["broadcast"] = broadcast;
+    rsp.map["routes"] = routes;
+    rsp.map["destinations"] = destinations;
+
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! Returns the summary of a histogram as map.
+ */
+static QVariantMap perfHistogramToMap(const PerfHistogram &h)
+{
+    QVariantMap map;
+    map["count"] = (double)h.count;
+    map["sum"] = (double)h.sum;
+    map["avg"] = h.count > 0 ? floor((double)h.sum / h.count) : 0.0;
+    map["max"] = (double)h.max;
+    map["p50"] = (double)h.percentile(50);
+    map["p90"] = (double)h.percentile(90);
+    map["p99"] = (double)h.percentile(99);
+    return map;
+}
+
+/*! Appends a histogram in the Prometheus text exposition format.
+    \param out - the output text
+    \param name - the metric name
+    \param labels - additional labels like route="GET lights" or empty
+    \param h - the histogram
+ */
+static void appendPrometheusHistogram(QString &out, const QString &name, const QString &labels, const PerfHistogram &h)
+{
+    const QString sep = labels.isEmpty() ? QString() : QString(labels + QLatin1Char(','));
+    quint64 n = 0;
+
+    for (int i = 0; i < PerfHistogram::Buckets; i++)
+    {
+        n += h.buckets[i];
+        const qint64 bound = PerfHistogram::upperBound(i);
+        const QString le = bound < 0 ? QString("+Inf") : QString::number(bound);
+        out += QString("%1_bucket{%2le=\"%3\"} %4\n").arg(name, sep, le).arg(n);
+    }
+
+    const QString braces = labels.isEmpty() ? QString() : QString("{" + labels + "}");
+    out += QString("%1_sum%2 %3\n").arg(name, braces).arg(h.sum);
+    out += QString("%1_count%2 %3\n").arg(name, braces).arg(h.count);
+}
+
+/*! Appends a single value in the Prometheus text exposition format.
+ */
+static void appendPrometheusValue(QString &out, const char *name, const char *type, double value)
+{
+    out += QString("# TYPE %1 %2\n%1 %3\n").arg(name, type).arg(value, 0, 'f', 0);
+}
+
+/*! GET /api/<apikey>/config/perf
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getPerfCounters(const ApiRequest &req, ApiResponse &rsp)
+{
+    if(!checkApikeyAuthentification(req, rsp))
+    {
+        return REQ_READY_SEND;
+    }
+
+    const PerfCounters &perf = perfCounters();
+
+    QVariantMap tasksMap;
+    tasksMap["queued"] = (double)tasks.size();
+    tasksMap["running"] = (double)runningTaskCount;
+    tasksMap["runningmax"] = (double)perf.tasksRunningMax;
+    tasksMap["added"] = (double)perf.tasksAdded;
+    tasksMap["coalesced"] = (double)perf.tasksCoalesced;
+    tasksMap["rejected"] = (double)perf.tasksRejected;
+    tasksMap["dropped"] = (double)perf.tasksDropped;
+    tasksMap["sent"] = (double)perf.tasksSent;
+    tasksMap["confirmed"] = (double)perf.tasksConfirmed;
+    tasksMap["failed"] = (double)perf.tasksFailed;
+    tasksMap["timedout"] = (double)perf.tasksTimedOut;
+    tasksMap["confirmlatency"] = perfHistogramToMap(perf.apsConfirmLatency);
+
+    QVariantMap eventsMap;
+    eventsMap["queued"] = (double)eventQueue.size();
+    eventsMap["queuedmax"] = (double)perf.eventQueueMax;
+    eventsMap["added"] = (double)perf.eventsQueued;
+    eventsMap["coalesced"] = (double)perf.eventsCoalesced;
+    eventsMap["processed"] = (double)perf.eventsProcessed;
+    eventsMap["age"] = perfHistogramToMap(perf.eventQueueAge);
+
+    QVariantMap httpMap;
+    QMap<QString, PerfHistogram>::const_iterator i = perf.httpRequestTime.constBegin();
+    QMap<QString, PerfHistogram>::const_iterator end = perf.httpRequestTime.constEnd();
+
+    for (; i != end; ++i)
+    {
+        httpMap[i.key()] = perfHistogramToMap(i.value());
+    }
+
+    QVariantMap dbMap;
+    dbMap["save"] = perfHistogramToMap(perf.dbSaveTime);
+
+    QVariantMap websocketMap;
+    websocketMap["messages"] = (double)perf.websocketMessages;
+    websocketMap["dropped"] = (double)perf.websocketDropped;
+    websocketMap["coalesced"] = (double)perf.websocketCoalesced;
+    websocketMap["disconnected"] = (double)perf.websocketDisconnected;
+
+    QVariantMap clientsMap;
+    QHash<QWebSocket*, WebSocketClient>::const_iterator c = webSocketServer->clients().constBegin();
+    QHash<QWebSocket*, WebSocketClient>::const_iterator cend = webSocketServer->clients().constEnd();
+
+    for (; c != cend; ++c)
+    {
+        QVariantMap client;
+        client["queued"] = (double)c->queue.size();
+        client["queuedbytes"] = (double)c->queuedBytes;
+        client["pendingbytes"] = (double)c->pendingBytes;
+        client["dropped"] = (double)c->dropped;
+        client["coalesced"] = (double)c->coalesced;
+        client["topics"] = (double)c->topics.size();
+        clientsMap[c->peer] = client;
+    }
+    websocketMap["clients"] = clientsMap;
+    websocketMap["broadcast"] = perfHistogramToMap(perf.websocketBroadcastTime);
+
+    rsp.map["uptime"] = (double)perf.resetTime.secsTo(steadyTimeRef());
+    rsp.map["tasks"] = tasksMap; // latency in ms
+    rsp.map["events"] = eventsMap; // age in ms
+    rsp.map["http"] = httpMap; // in us
+    rsp.map["database"] = dbMap; // in ms
+    rsp.map["websocket"] = websocketMap; // in us
+
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! GET /api/<apikey>/config/perf/metrics
+    Returns the counters in the Prometheus text exposition format.
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getPerfMetrics(const ApiRequest &req, ApiResponse &rsp)
+{
+    if(!checkApikeyAuthentification(req, rsp))
+    {
+        return REQ_READY_SEND;
+    }
+
+    const PerfCounters &perf = perfCounters();
+    QString out;
+
+    appendPrometheusValue(out, "deconz_tasks_queued", "gauge", tasks.size());
+    appendPrometheusValue(out, "deconz_tasks_running", "gauge", runningTaskCount);
+    appendPrometheusValue(out, "deconz_tasks_running_max", "gauge", perf.tasksRunningMax);
+
+    out += "# TYPE deconz_tasks_total counter\n";
+    out += QString("deconz_tasks_total{result=\"added\"} %1\n").arg(perf.tasksAdded);
+    out += QString("deconz_tasks_total{result=\"coalesced\"} %1\n").arg(perf.tasksCoalesced);
+    out += QString("deconz_tasks_total{result=\"rejected\"} %1\n").arg(perf.tasksRejected);
+    out += QString("deconz_tasks_total{result=\"dropped\"} %1\n").arg(perf.tasksDropped);
+    out += QString("deconz_tasks_total{result=\"sent\"} %1\n").arg(perf.tasksSent);
+    out += QString("deconz_tasks_total{result=\"confirmed\"} %1\n").arg(perf.tasksConfirmed);
+    out += QString("deconz_tasks_total{result=\"failed\"} %1\n").arg(perf.tasksFailed);
+    out += QString("deconz_tasks_total{result=\"timedout\"} %1\n").arg(perf.tasksTimedOut);
+
+    out += "# TYPE deconz_aps_confirm_latency_milliseconds histogram\n";
+    appendPrometheusHistogram(out, "deconz_aps_confirm_latency_milliseconds", QString(), perf.apsConfirmLatency);
+
+    appendPrometheusValue(out, "deconz_events_queued", "gauge", eventQueue.size());
+    appendPrometheusValue(out, "deconz_events_queued_max", "gauge", perf.eventQueueMax);
+    appendPrometheusValue(out, "deconz_events_added_total", "counter", perf.eventsQueued);
+    appendPrometheusValue(out, "deconz_events_coalesced_total", "counter", perf.eventsCoalesced);
+    appendPrometheusValue(out, "deconz_events_processed_total", "counter", perf.eventsProcessed);
+
+    out += "# TYPE deconz_event_queue_age_milliseconds histogram\n";
+    appendPrometheusHistogram(out, "deconz_event_queue_age_milliseconds", QString(), perf.eventQueueAge);
+
+    out += "# TYPE deconz_http_request_duration_microseconds histogram\n";
+    QMap<QString, PerfHistogram>::const_iterator i = perf.httpRequestTime.constBegin();
+    QMap<QString, PerfHistogram>::const_iterator end = perf.httpRequestTime.constEnd();
+
+    for (; i != end; ++i)
+    {
+        appendPrometheusHistogram(out, "deconz_http_request_duration_microseconds", QString("route=\"%1\"").arg(i.key()), i.value());
+    }
+
+    out += "# TYPE deconz_db_save_duration_milliseconds histogram\n";
+    appendPrometheusHistogram(out, "deconz_db_save_duration_milliseconds", QString(), perf.dbSaveTime);
+
+    appendPrometheusValue(out, "deconz_websocket_messages_total", "counter", perf.websocketMessages);
+    appendPrometheusValue(out, "deconz_websocket_dropped_total", "counter", perf.websocketDropped);
+    appendPrometheusValue(out, "deconz_websocket_coalesced_total", "counter", perf.websocketCoalesced);
+    appendPrometheusValue(out, "deconz_websocket_disconnected_total", "counter", perf.websocketDisconnected);
+
+    out += "# TYPE deconz_websocket_client_queued gauge\n";
+    QHash<QWebSocket*, WebSocketClient>::const_iterator c = webSocketServer->clients().constBegin();
+    QHash<QWebSocket*, WebSocketClient>::const_iterator cend = webSocketServer->clients().constEnd();
+
+    for (; c != cend; ++c)
+    {
+        out += QString("deconz_websocket_client_queued{client=\"%1\"} %2\n").arg(c->peer).arg((uint)c->queue.size());
+    }
+
+    out += "# TYPE deconz_websocket_client_queued_bytes gauge\n";
+    for (c = webSocketServer->clients().constBegin(); c != cend; ++c)
+    {
+        out += QString("deconz_websocket_client_queued_bytes{client=\"%1\"} %2\n").arg(c->peer).arg(c->queuedBytes);
+    }
+    out += "# TYPE deconz_websocket_broadcast_duration_microseconds histogram\n";
+    appendPrometheusHistogram(out, "deconz_websocket_broadcast_duration_microseconds", QString(), perf.websocketBroadcastTime);
+
+    rsp.str = out;
+    rsp.contentType = HttpContentText;
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! DELETE /api/<apikey>/config/perf
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::resetPerfCounters(const ApiRequest &req, ApiResponse &rsp)
+{
+    if(!checkApikeyAuthentification(req, rsp))
+    {
+        return REQ_READY_SEND;
+    }
+
+    perfCounters().reset();
+
+    QVariantMap rspItem;
+    rspItem["success"] = QLatin1String("/config/perf reset");
+    rsp.list.append(rspItem);
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
 /*! PUT /api/config/wifi/restore
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
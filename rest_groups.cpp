@@ -110,38 +110,39 @@ int DeRestPluginPrivate::handleGroupsApi(ApiRequest &req, ApiResponse &rsp)
 }
 
 /*! GET /api/<apikey>/groups
+    GET /api/<apikey>/groups?since=<version>
+
+    With since the response is { "groups": { "full": <bool>, "changed": { ... }, "deleted": [ ... ] },
+    "version": <version> }. "full": true means since wasn't from this run, "changed" then
+    holds all groups and replaces the client state.
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
  */
 int DeRestPluginPrivate::getAllGroups(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req);
     rsp.httpStatus = HttpStatusOk;
 
-    std::vector<Group>::const_iterator i = groups.begin();
-    std::vector<Group>::const_iterator end = groups.end();
-
-    for (; i != end; ++i)
+    // handle ETag
+    if (checkEtag(req, rsp, gwGroupsEtag))
     {
-        // ignore deleted groups
-        if (i->state() == Group::StateDeleted || i->state() == Group::StateDeleteFromDB)
-        {
-            continue;
-        }
-
-        if (i->address() != 0) // don't return special group 0
-        {
-            QVariantMap mnode;
-            groupToMap(&(*i), mnode);
-            rsp.map[i->id()] = mnode;
-        }
+        return REQ_READY_SEND;
     }
 
-    if (rsp.map.isEmpty())
+    // delta request
+    quint64 since;
+    if (sinceVersion(req, &since))
     {
-        rsp.str = "{}"; // return empty object
+        QByteArray json("{\"groups\":");
+        json += groupsDeltaToJson(since);
+        json += ",\"version\":";
+        json += QByteArray::number(etagVersion);
+        json += '}';
+        rsp.str = QString::fromUtf8(json);
+        return REQ_READY_SEND;
     }
 
+    rsp.str = QString::fromUtf8(groupsToJson());
+
     return REQ_READY_SEND;
 }
 
@@ -317,16 +318,9 @@ int DeRestPluginPrivate::getGroupAttributes(const ApiRequest &req, ApiResponse &
     }
 
     // handle ETag
-    if (req.hdr.hasKey("If-None-Match"))
+    if (checkEtag(req, rsp, group->etag))
     {
-        QString etag = req.hdr.value("If-None-Match");
-
-        if (group->etag == etag)
-        {
-            rsp.httpStatus = HttpStatusNotModified;
-            rsp.etag = etag;
-            return REQ_READY_SEND;
-        }
+        return REQ_READY_SEND;
     }
 
     groupToMap(group,rsp.map);
@@ -478,6 +472,7 @@ int DeRestPluginPrivate::setGroupAttributes(const ApiRequest &req, ApiResponse &
                             {
                                 lightNode->setNeedSaveDatabase(true);
                                 groupInfo->state = GroupInfo::StateInGroup;
+                                indexLightGroups(lightNode);
                                 ResourceItem *item = lightNode->item(RStateOn);
                                 if (item && item->toBool())
                                 {
@@ -522,8 +517,8 @@ int DeRestPluginPrivate::setGroupAttributes(const ApiRequest &req, ApiResponse &
 
             // for each node which are currently in the group but not in the list send a remove group command (unicast)
             // note: nodes which are currently switched off will not be removed from the group
-            std::vector<LightNode>::iterator j = nodes.begin();
-            std::vector<LightNode>::iterator jend = nodes.end();
+            SlotMap<LightNode>::iterator j = nodes.begin();
+            SlotMap<LightNode>::iterator jend = nodes.end();
             for (; j != jend; ++j)
             {
                 if (lids.contains(j->id()))
@@ -542,6 +537,7 @@ int DeRestPluginPrivate::setGroupAttributes(const ApiRequest &req, ApiResponse &
                         k->actions |= GroupInfo::ActionRemoveFromGroup;
                         k->state = GroupInfo::StateNotInGroup;
                         j->setNeedSaveDatabase(true);
+                        indexLightGroups(&*j);
 
                         //delete Light from all scenes
                         deleteLightFromScenes(j->id(), k->id);
@@ -719,26 +715,26 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
                 addTaskSetColorLoop(task, false, 15);
                 group->setColorLoopActive(false); // deactivate colorloop if active
             }
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
+            std::vector<LightNode*> lightNodes;
+            getLightNodesInGroup(group->address(), lightNodes);
+            std::vector<LightNode*>::iterator i = lightNodes.begin();
+            std::vector<LightNode*>::iterator end = lightNodes.end();
 
             for (; i != end; ++i)
             {
-                if (isLightNodeInGroup(&(*i), group->address()))
+                LightNode *lightNode = *i;
+                if (lightNode->isColorLoopActive() && lightNode->isAvailable() && lightNode->state() != LightNode::StateDeleted)
                 {
-                    if (i->isColorLoopActive() && i->isAvailable() && i->state() != LightNode::StateDeleted)
-                    {
-                        TaskItem task2;
-                        task2.lightNode = &(*i);
-                        task2.req.dstAddress() = task2.lightNode->address();
-                        task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
-                        task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
-                        task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
-                        task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
-
-                        addTaskSetColorLoop(task2, false, 15);
-                        i->setColorLoopActive(false);
-                    }
+                    TaskItem task2;
+                    task2.lightNode = lightNode;
+                    task2.req.dstAddress() = task2.lightNode->address();
+                    task2.req.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+                    task2.req.setDstEndpoint(task2.lightNode->haEndpoint().endpoint());
+                    task2.req.setSrcEndpoint(getSrcEndpoint(task2.lightNode, task2.req));
+                    task2.req.setDstAddressMode(deCONZ::ApsExtAddress);
+
+                    addTaskSetColorLoop(task2, false, 15);
+                    lightNode->setColorLoopActive(false);
                 }
             }
 
@@ -1143,15 +1139,14 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
                     if (ok && (map["colorloopspeed"].type() == QVariant::Double) && (speed < 256) && (speed > 0))
                     {
                         // ok
-                        std::vector<LightNode>::iterator i = nodes.begin();
-                        std::vector<LightNode>::iterator end = nodes.end();
+                        std::vector<LightNode*> lightNodes;
+                        getLightNodesInGroup(group->address(), lightNodes);
+                        std::vector<LightNode*>::iterator i = lightNodes.begin();
+                        std::vector<LightNode*>::iterator end = lightNodes.end();
 
                         for (; i != end; ++i)
                         {
-                            if (isLightNodeInGroup(&(*i), group->address()))
-                            {
-                                i->setColorLoopSpeed(speed);
-                            }
+                            (*i)->setColorLoopSpeed(speed);
                         }
                     }
                     else
@@ -1184,8 +1179,8 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
     }
 
     { // update lights state
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlotMap<LightNode>::iterator i = nodes.begin();
+        SlotMap<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -1396,6 +1391,7 @@ int DeRestPluginPrivate::deleteGroup(const ApiRequest &req, ApiResponse &rsp)
 
     // remove any known scene
     group->scenes.clear();
+    updateGroupEtag(group);
 
     QVariantMap rspItem;
     QVariantMap rspItemState;
@@ -1408,8 +1404,8 @@ int DeRestPluginPrivate::deleteGroup(const ApiRequest &req, ApiResponse &rsp)
 
     // for each node which is part of this group send a remove group request (will be unicast)
     // note: nodes which are curently switched off will not be removed!
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -1421,6 +1417,7 @@ int DeRestPluginPrivate::deleteGroup(const ApiRequest &req, ApiResponse &rsp)
             groupInfo->actions &= ~GroupInfo::ActionAddToGroup; // sanity
             groupInfo->actions |= GroupInfo::ActionRemoveFromGroup;
             groupInfo->state = GroupInfo::StateNotInGroup;
+            indexLightGroups(&*i);
         }
     }
 
@@ -1496,6 +1493,7 @@ bool DeRestPluginPrivate::groupToMap(const Group *group, QVariantMap &map)
         const ResourceItem *item = group->itemForIndex(i);
         DBG_Assert(item != 0);
         if (item->descriptor().suffix == RStateAnyOn) { state["any_on"] = item->toBool(); }
+        else if (item->descriptor().suffix == RStateAllOn) { state["all_on"] = item->toBool(); }
     }
 
     map["id"] = group->id();
@@ -1542,8 +1540,8 @@ bool DeRestPluginPrivate::groupToMap(const Group *group, QVariantMap &map)
 
     // append lights which are known members in this group
     QVariantList lights;
-    std::vector<LightNode>::const_iterator i = nodes.begin();
-    std::vector<LightNode>::const_iterator end = nodes.end();
+    SlotMap<LightNode>::const_iterator i = nodes.begin();
+    SlotMap<LightNode>::const_iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -1592,6 +1590,162 @@ bool DeRestPluginPrivate::groupToMap(const Group *group, QVariantMap &map)
     return true;
 }
 
+/*! Returns the JSON of a group as UTF-8 without the "lights" member.
+    The lights are added by groupsToJson() since they change with the lights.
+    The JSON is cached in the group and only rebuilt when its version or one of its items changed.
+ */
+const QByteArray &DeRestPluginPrivate::groupToJson(Group *group)
+{
+    const quint64 changeSeq = group->changeSeq();
+    if (group->version == 0 || group->jsonVersion != group->version || group->jsonChangeSeq != changeSeq)
+    {
+        QVariantMap map;
+        if (groupToMap(group, map))
+        {
+            map.remove(QLatin1String("lights"));
+            group->json = Json::serialize(map);
+        }
+        else
+        {
+            group->json.clear();
+        }
+        group->jsonVersion = group->version;
+        group->jsonChangeSeq = changeSeq;
+    }
+
+    return group->json;
+}
+
+/*! Returns the JSON object of all groups as UTF-8, assembled from the cached JSON of each group.
+    The members of all groups are collected in one pass over the lights.
+ */
+QByteArray DeRestPluginPrivate::groupsToJson()
+{
+    QHash<quint16, QVariantList> members; // group address -> light ids
+
+    {
+        SlotMap<LightNode>::const_iterator i = nodes.begin();
+        SlotMap<LightNode>::const_iterator end = nodes.end();
+
+        for (; i != end; ++i)
+        {
+            if (i->state() == LightNode::StateDeleted)
+            {
+                continue;
+            }
+
+            std::vector<GroupInfo>::const_iterator g = i->groups().begin();
+            std::vector<GroupInfo>::const_iterator gend = i->groups().end();
+
+            for (; g != gend; ++g)
+            {
+                if (g->state == GroupInfo::StateInGroup)
+                {
+                    members[g->id].append(i->id());
+                }
+            }
+        }
+    }
+
+    QByteArray json("{");
+
+    std::vector<Group>::iterator i = groups.begin();
+    std::vector<Group>::iterator end = groups.end();
+
+    for (; i != end; ++i)
+    {
+        // ignore deleted groups and special group 0
+        if (i->state() == Group::StateDeleted || i->state() == Group::StateDeleteFromDB || i->address() == 0)
+        {
+            continue;
+        }
+
+        const QByteArray &group = groupToJson(&*i);
+        if (group.size() < 2)
+        {
+            continue;
+        }
+
+        if (json.size() > 1)
+        {
+            json += ',';
+        }
+        json += Json::serialize(i->id());
+        json += ':';
+        json += group.left(group.size() - 1); // without the closing brace
+        json += ",\"lights\":";
+        json += Json::serialize(members.value(i->address()));
+        json += '}';
+    }
+
+    json += '}';
+    return json;
+}
+
+/*! Returns the groups changed after version \p since as UTF-8 JSON object
+    { "full": false, "changed": { <id>: <group>, ... }, "deleted": [<id>, ...] }.
+    The groups are taken from the change index, so unchanged groups are not visited.
+    A version which isn't from this run gets all groups with "full": true, the client must
+    then replace its state instead of merging, since deletions of earlier runs aren't listed.
+ */
+QByteArray DeRestPluginPrivate::groupsDeltaToJson(quint64 since)
+{
+    if (since < etagBaseVersion || since > etagVersion)
+    {
+        return "{\"full\":true,\"changed\":" + groupsToJson() + ",\"deleted\":[]}";
+    }
+
+    QByteArray json("{\"full\":false,\"changed\":{");
+    QVariantList deleted;
+
+    QMap<quint64, QString>::const_iterator i = groupsChanges.upperBound(since);
+    QMap<quint64, QString>::const_iterator end = groupsChanges.constEnd();
+
+    for (; i != end; ++i)
+    {
+        if (i.value().isEmpty())
+        {
+            continue;
+        }
+
+        Group *group = getGroupForId(i.value());
+        if (group && group->version != i.key())
+        {
+            continue; // the id was reused, the current group has its own entry
+        }
+
+        if (!group || group->state() == Group::StateDeleted || group->state() == Group::StateDeleteFromDB)
+        {
+            deleted.append(i.value());
+            continue;
+        }
+
+        if (group->address() == 0) // special group 0
+        {
+            continue;
+        }
+
+        QVariantMap map;
+        groupToMap(group, map); // with the lights, see groupsToJson()
+        const QByteArray itemJson = Json::serialize(map);
+        if (!itemJson.isEmpty())
+        {
+            if (!json.endsWith('{'))
+            {
+                json += ',';
+            }
+            json += Json::serialize(i.value());
+            json += ':';
+            json += itemJson;
+        }
+    }
+
+    json += "},\"deleted\":";
+    json += Json::serialize(deleted);
+    json += '}';
+    return json;
+}
+
 /*! POST /api/<apikey>/groups/<group_id>/scenes
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -1749,8 +1903,8 @@ int DeRestPluginPrivate::createScene(const ApiRequest &req, ApiResponse &rsp)
         scene.name.sprintf("Scene %u", scene.id);
     }
 
-    std::vector<LightNode>::iterator ni = nodes.begin();
-    std::vector<LightNode>::iterator nend = nodes.end();
+    SlotMap<LightNode>::iterator ni = nodes.begin();
+    SlotMap<LightNode>::iterator nend = nodes.end();
     for (; ni != nend; ++ni)
     {
         LightNode *lightNode = &(*ni);
@@ -1865,6 +2019,12 @@ int DeRestPluginPrivate::getAllScenes(const ApiRequest &req, ApiResponse &rsp)
         return REQ_READY_SEND;
     }
 
+    // scenes are part of the group ETag
+    if (checkEtag(req, rsp, group->etag))
+    {
+        return REQ_READY_SEND;
+    }
+
     std::vector<Scene>::const_iterator i = group->scenes.begin();
     std::vector<Scene>::const_iterator end = group->scenes.end();
 
@@ -1917,6 +2077,12 @@ int DeRestPluginPrivate::getSceneAttributes(const ApiRequest &req, ApiResponse &
         return REQ_READY_SEND;
     }
 
+    // scenes are part of the group ETag
+    if (checkEtag(req, rsp, group->etag))
+    {
+        return REQ_READY_SEND;
+    }
+
     std::vector<Scene>::const_iterator i = group->scenes.begin();
     std::vector<Scene>::const_iterator end = group->scenes.end();
 
@@ -2150,8 +2316,8 @@ int DeRestPluginPrivate::storeScene(const ApiRequest &req, ApiResponse &rsp)
     }
 
     // search for lights that have their scenes capacity reached or need to be updated
-    std::vector<LightNode>::iterator ni = nodes.begin();
-    std::vector<LightNode>::iterator nend = nodes.end();
+    SlotMap<LightNode>::iterator ni = nodes.begin();
+    SlotMap<LightNode>::iterator nend = nodes.end();
     for (; ni != nend; ++ni)
     {
         LightNode *lightNode = &(*ni);
@@ -2945,43 +3111,46 @@ void DeRestPluginPrivate::handleGroupEvent(const Event &e)
 
     if (e.what() == REventCheckGroupAnyOn)
     {
-        int on = 0;
-        int count = 0;
-
-        std::vector<LightNode>::const_iterator i = nodes.begin();
-        std::vector<LightNode>::const_iterator end = nodes.end();
+        GroupIndex::Counters counters = groupIndex.counters(e.num());
 
-        for (; i != end; ++i)
+        if (e.num() == 0) // global group isn't indexed
         {
-            if (!isLightNodeInGroup(&*i, e.num()))
-            {
-                continue;
-            }
-
-            const ResourceItem *item = i->item(RStateOn);
+            SlotMap<LightNode>::const_iterator i = nodes.begin();
+            SlotMap<LightNode>::const_iterator end = nodes.end();
 
-            if (i->isAvailable() && item)
+            for (; i != end; ++i)
             {
-                count++;
-                if (item->toBool()) { on++; }
+                if (i->isAvailable())
+                {
+                    const ResourceItem *item = i->item(RStateOn);
+                    counters.reachable++;
+                    if (item && item->toBool()) { counters.reachableOn++; }
+                }
             }
+        }
 
-            if (on)
+        bool changed = false;
+        const char *suffixes[] = { RStateAnyOn, RStateAllOn };
+        const bool values[] = { counters.anyOn(), counters.allOn() };
+
+        for (size_t n = 0; n < 2; n++)
+        {
+            ResourceItem *item = group->item(suffixes[n]);
+            DBG_Assert(item != 0);
+            if (item && item->toBool() != values[n])
             {
-                break; // any
+                item->setValue(values[n]);
+                Event e(RGroups, suffixes[n], group->address());
+                enqueueEvent(e);
+                changed = true;
             }
         }
 
-        ResourceItem *item = group->item(RStateAnyOn);
-        DBG_Assert(item != 0);
-        if (item && item->toBool() != (on > 0))
+        if (changed)
         {
-            item->setValue(on > 0);
             updateGroupEtag(group);
-            Event e(RGroups, RStateAnyOn, group->address());
-            enqueueEvent(e);
-            return;
         }
+        return;
     }
 
     // push state updates through websocket
@@ -2996,10 +3165,10 @@ void DeRestPluginPrivate::handleGroupEvent(const Event &e)
             map["r"] = QLatin1String("groups");
             map["id"] = group->id();
             QVariantMap state;
-            state[e.what() + 6] = item->toVariant();
+            state[e.what() + 6] = e.value().isValid() ? e.value() : item->toVariant(); // value when queued
             map["state"] = state;
 
-            webSocketServer->broadcastTextMessage(Json::serialize(map));
+            webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("groups"), group->id(), e.what() + 6);
         }
     }
     else if (e.what() == REventAdded)
@@ -3010,7 +3179,7 @@ void DeRestPluginPrivate::handleGroupEvent(const Event &e)
         map["r"] = QLatin1String("groups");
         map["id"] = e.id();
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("groups"), group->id());
     }
     else if (e.what() == REventDeleted)
     {
@@ -3020,7 +3189,7 @@ void DeRestPluginPrivate::handleGroupEvent(const Event &e)
         map["r"] = QLatin1String("groups");
         map["id"] = e.id();
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("groups"), group->id());
     }
 }
 
@@ -96,36 +96,39 @@ int DeRestPluginPrivate::handleLightsApi(ApiRequest &req, ApiResponse &rsp)
 }
 
 /*! GET /api/<apikey>/lights
+    GET /api/<apikey>/lights?since=<version>
+
+    With since the response is { "lights": { "full": <bool>, "changed": { ... }, "deleted": [ ... ] },
+    "version": <version> }. "full": true means since wasn't from this run, "changed" then
+    holds all lights and replaces the client state.
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
  */
 int DeRestPluginPrivate::getAllLights(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req);
     rsp.httpStatus = HttpStatusOk;
 
-    std::vector<LightNode>::const_iterator i = nodes.begin();
-    std::vector<LightNode>::const_iterator end = nodes.end();
-
-    for (; i != end; ++i)
+    // handle ETag
+    if (checkEtag(req, rsp, gwLightsEtag))
     {
-        if (i->state() == LightNode::StateDeleted)
-        {
-            continue;
-        }
-
-        QVariantMap mnode;
-        if (lightToMap(req, &*i, mnode))
-        {
-            rsp.map[i->id()] = mnode;
-        }
+        return REQ_READY_SEND;
     }
 
-    if (rsp.map.isEmpty())
+    // delta request
+    quint64 since;
+    if (sinceVersion(req, &since))
     {
-        rsp.str = "{}"; // return empty object
+        QByteArray json("{\"lights\":");
+        json += lightsDeltaToJson(req, since);
+        json += ",\"version\":";
+        json += QByteArray::number(etagVersion);
+        json += '}';
+        rsp.str = QString::fromUtf8(json);
+        return REQ_READY_SEND;
     }
 
+    rsp.str = QString::fromUtf8(lightsToJson(req));
+
     return REQ_READY_SEND;
 }
 
@@ -193,15 +196,19 @@ bool DeRestPluginPrivate::lightToMap(const ApiRequest &req, const LightNode *lig
         const ResourceItem *item = lightNode->itemForIndex(i);
         DBG_Assert(item != 0);
 
-        if      (item->descriptor().suffix == RStateOn) { state["on"] = item->toBool(); }
-        else if (item->descriptor().suffix == RStateBri) { state["bri"] = (double)item->toNumber(); }
-        else if (item->descriptor().suffix == RStateHue) { state["hue"] = (double)item->toNumber(); }
-        else if (item->descriptor().suffix == RStateSat) { state["sat"] = (double)item->toNumber(); }
-        else if (item->descriptor().suffix == RStateCt) { state["ct"] = (double)item->toNumber(); }
-        else if (item->descriptor().suffix == RStateColorMode) { state["colormode"] = item->toString(); }
-        else if (item->descriptor().suffix == RStateX) { ix = item; }
-        else if (item->descriptor().suffix == RStateY) { iy = item; }
-        else if (item->descriptor().suffix == RStateReachable) { state["reachable"] = item->toBool(); }
+        switch (item->descriptor().suffixId)
+        {
+        case RIdStateOn: state["on"] = item->toBool(); break;
+        case RIdStateBri: state["bri"] = (double)item->toNumber(); break;
+        case RIdStateHue: state["hue"] = (double)item->toNumber(); break;
+        case RIdStateSat: state["sat"] = (double)item->toNumber(); break;
+        case RIdStateCt: state["ct"] = (double)item->toNumber(); break;
+        case RIdStateColorMode: state["colormode"] = item->toString(); break;
+        case RIdStateX: ix = item; break;
+        case RIdStateY: iy = item; break;
+        case RIdStateReachable: state["reachable"] = item->toBool(); break;
+        default: break;
+        }
     }
 
     state["alert"] = "none"; // TODO
@@ -256,6 +263,120 @@ bool DeRestPluginPrivate::lightToMap(const ApiRequest &req, const LightNode *lig
     return true;
 }
 
+/*! Returns the JSON of a light as UTF-8.
+    The JSON is cached in the light and only rebuilt when its version or one of its items changed.
+ */
+const QByteArray &DeRestPluginPrivate::lightToJson(const ApiRequest &req, LightNode *lightNode)
+{
+    const quint64 changeSeq = lightNode->changeSeq();
+    if (lightNode->version == 0 || lightNode->jsonVersion != lightNode->version || lightNode->jsonChangeSeq != changeSeq)
+    {
+        QVariantMap map;
+        if (lightToMap(req, lightNode, map))
+        {
+            lightNode->json = Json::serialize(map);
+        }
+        else
+        {
+            lightNode->json.clear();
+        }
+        lightNode->jsonVersion = lightNode->version;
+        lightNode->jsonChangeSeq = changeSeq;
+    }
+
+    return lightNode->json;
+}
+
+/*! Returns the JSON object of all lights as UTF-8, assembled from the cached JSON of each light.
+ */
+QByteArray DeRestPluginPrivate::lightsToJson(const ApiRequest &req)
+{
+    QByteArray json("{");
+
+    SlotMap<LightNode>::iterator i = nodes.begin();
+    SlotMap<LightNode>::iterator end = nodes.end();
+
+    for (; i != end; ++i)
+    {
+        if (i->state() == LightNode::StateDeleted)
+        {
+            continue;
+        }
+
+        const QByteArray &light = lightToJson(req, &*i);
+        if (!light.isEmpty())
+        {
+            if (json.size() > 1)
+            {
+                json += ',';
+            }
+            json += Json::serialize(i->id());
+            json += ':';
+            json += light;
+        }
+    }
+
+    json += '}';
+    return json;
+}
+
+/*! Returns the lights changed after version \p since as UTF-8 JSON object
+    { "full": false, "changed": { <id>: <light>, ... }, "deleted": [<id>, ...] }.
+    The lights are taken from the change index, so unchanged lights are not visited.
+    A version which isn't from this run gets all lights with "full": true, the client must
+    then replace its state instead of merging, since deletions of earlier runs aren't listed.
+ */
+QByteArray DeRestPluginPrivate::lightsDeltaToJson(const ApiRequest &req, quint64 since)
+{
+    if (since < etagBaseVersion || since > etagVersion)
+    {
+        return "{\"full\":true,\"changed\":" + lightsToJson(req) + ",\"deleted\":[]}";
+    }
+
+    QByteArray json("{\"full\":false,\"changed\":{");
+    QVariantList deleted;
+
+    QMap<quint64, QString>::const_iterator i = lightsChanges.upperBound(since);
+    QMap<quint64, QString>::const_iterator end = lightsChanges.constEnd();
+
+    for (; i != end; ++i)
+    {
+        if (i.value().isEmpty())
+        {
+            continue;
+        }
+
+        LightNode *lightNode = getLightNodeForId(i.value());
+        if (lightNode && lightNode->version != i.key())
+        {
+            continue; // the id was reused, the current light has its own entry
+        }
+
+        if (!lightNode || lightNode->state() == LightNode::StateDeleted)
+        {
+            deleted.append(i.value());
+            continue;
+        }
+
+        const QByteArray itemJson = lightToJson(req, lightNode);
+        if (!itemJson.isEmpty())
+        {
+            if (!json.endsWith('{'))
+            {
+                json += ',';
+            }
+            json += Json::serialize(i.value());
+            json += ':';
+            json += itemJson;
+        }
+    }
+
+    json += "},\"deleted\":";
+    json += Json::serialize(deleted);
+    json += '}';
+    return json;
+}
+
 /*! GET /api/<apikey>/lights/<id>
     \return 0 - on success
            -1 - on error
@@ -320,21 +441,13 @@ int DeRestPluginPrivate::getLightState(const ApiRequest &req, ApiResponse &rsp)
     }
 
     // handle ETag
-    if (req.hdr.hasKey("If-None-Match"))
+    if (checkEtag(req, rsp, lightNode->etag))
     {
-        QString etag = req.hdr.value("If-None-Match");
-
-        if (lightNode->etag == etag)
-        {
-            rsp.httpStatus = HttpStatusNotModified;
-            rsp.etag = etag;
-            return REQ_READY_SEND;
-        }
+        return REQ_READY_SEND;
     }
 
     lightToMap(req, lightNode, rsp.map);
     rsp.httpStatus = HttpStatusOk;
-    rsp.etag = lightNode->etag;
 
     return REQ_READY_SEND;
 }
@@ -1121,6 +1234,7 @@ int DeRestPluginPrivate::deleteLight(const ApiRequest &req, ApiResponse &rsp)
             g->state = GroupInfo::StateNotInGroup;
         }
     }
+    indexLightGroups(lightNode);
 
     if (lightNode->state() != LightNode::StateDeleted)
     {
@@ -1233,6 +1347,7 @@ int DeRestPluginPrivate::removeAllGroups(const ApiRequest &req, ApiResponse &rsp
             lightNode->setNeedSaveDatabase(true);
         }
     }
+    indexLightGroups(lightNode);
 
     updateLightEtag(lightNode);
     queSaveDb(DB_LIGHTS, DB_SHORT_SAVE_DELAY);
@@ -1473,13 +1588,26 @@ void DeRestPluginPrivate::handleLightEvent(const Event &e)
             map["r"] = QLatin1String("lights");
             map["id"] = e.id();
             QVariantMap state;
-            state[e.what() + 6] = item->toVariant();
+            state[e.what() + 6] = e.value().isValid() ? e.value() : item->toVariant(); // value when queued
             map["state"] = state;
 
-            webSocketServer->broadcastTextMessage(Json::serialize(map));
+            QStringList rooms; // groups in which the light is member
+            std::vector<GroupInfo>::const_iterator g = lightNode->groups().begin();
+            std::vector<GroupInfo>::const_iterator gend = lightNode->groups().end();
+            for (; g != gend; ++g)
+            {
+                if (g->state == GroupInfo::StateInGroup)
+                {
+                    rooms.append(QString::number(g->id));
+                }
+            }
 
-            if (e.what() == RStateOn && !lightNode->groups().empty())
+            webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("lights"), e.id(), e.what() + 6, true, rooms);
+
+            if ((e.what() == RStateOn || e.what() == RStateReachable) && !lightNode->groups().empty())
             {
+                indexLightGroups(lightNode); // refresh group counters
+
                 std::vector<GroupInfo>::const_iterator i = lightNode->groups().begin();
                 std::vector<GroupInfo>::const_iterator end = lightNode->groups().end();
                 for (; i != end; ++i)
@@ -1501,7 +1629,7 @@ void DeRestPluginPrivate::handleLightEvent(const Event &e)
         map["r"] = QLatin1String("lights");
         map["id"] = e.id();
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("lights"), e.id());
     }
     else if (e.what() == REventDeleted)
     {
@@ -1511,6 +1639,6 @@ void DeRestPluginPrivate::handleLightEvent(const Event &e)
         map["r"] = QLatin1String("lights");
         map["id"] = e.id();
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("lights"), e.id());
     }
 }
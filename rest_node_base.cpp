@@ -256,32 +256,31 @@ void RestNodeBase::setMgmtBindSupported(bool supported)
  */
 void RestNodeBase::setZclValue(NodeValue::UpdateType updateType, quint16 clusterId, quint16 attributeId, const deCONZ::NumericUnion &value)
 {
-    std::vector<NodeValue>::iterator i = m_values.begin();
-    std::vector<NodeValue>::iterator end = m_values.end();
+    const SteadyTimeRef now = steadyTimeRef();
+    const quint32 key = (quint32(clusterId) << 16) | attributeId;
+    int idx = valueIndex(key);
 
-    for (; i != end; ++i)
+    if (idx >= 0)
     {
-        if (i->clusterId == clusterId &&
-            i->attributeId == attributeId)
-        {
-            i->updateType = updateType;
-            i->value = value;
-            int dt = i->timestamp.restart();
+        NodeValue &val = m_values[idx];
+        val.updateType = updateType;
+        val.value = value;
+        qint64 dt = val.timestamp.msecsTo(now);
+        val.timestamp = now;
 
-            if (updateType == NodeValue::UpdateByZclReport)
-            {
-                i->timestampLastReport.start();
-            }
-            DBG_Printf(DBG_INFO, "update ZCL value 0x%04X/0x%04X for 0x%016llX after %d ms\n", clusterId, attributeId, address().ext(), dt);
-            return;
+        if (updateType == NodeValue::UpdateByZclReport)
+        {
+            val.timestampLastReport = now;
         }
+        DBG_Printf(DBG_INFO, "update ZCL value 0x%04X/0x%04X for 0x%016llX after %d ms\n", clusterId, attributeId, address().ext(), (int)dt);
+        return;
     }
 
     NodeValue val;
-    val.timestamp.start();
+    val.timestamp = now;
     if (updateType == NodeValue::UpdateByZclReport)
     {
-        val.timestampLastReport.start();
+        val.timestampLastReport = now;
     }
     val.clusterId = clusterId;
     val.attributeId = attributeId;
@@ -291,6 +290,7 @@ void RestNodeBase::setZclValue(NodeValue::UpdateType updateType, quint16 cluster
     DBG_Printf(DBG_INFO, "added ZCL value 0x%04X/0x%04X for 0x%016llX\n", clusterId, attributeId, address().ext());
 
     m_values.push_back(val);
+    insertValueIndex(key, m_values.size() - 1);
 }
 
 /*! Returns a numeric ZCL attribute value.
@@ -301,16 +301,10 @@ void RestNodeBase::setZclValue(NodeValue::UpdateType updateType, quint16 cluster
  */
 const NodeValue &RestNodeBase::getZclValue(quint16 clusterId, quint16 attributeId) const
 {
-    std::vector<NodeValue>::const_iterator i = m_values.begin();
-    std::vector<NodeValue>::const_iterator end = m_values.end();
-
-    for (; i != end; ++i)
+    int idx = valueIndex((quint32(clusterId) << 16) | attributeId);
+    if (idx >= 0)
     {
-        if (i->clusterId == clusterId &&
-            i->attributeId == attributeId)
-        {
-            return *i;
-        }
+        return m_values[idx];
     }
 
     return m_invalidValue;
@@ -324,17 +318,84 @@ const NodeValue &RestNodeBase::getZclValue(quint16 clusterId, quint16 attributeI
  */
 NodeValue &RestNodeBase::getZclValue(quint16 clusterId, quint16 attributeId)
 {
-    std::vector<NodeValue>::iterator i = m_values.begin();
-    std::vector<NodeValue>::iterator end = m_values.end();
+    int idx = valueIndex((quint32(clusterId) << 16) | attributeId);
+    if (idx >= 0)
+    {
+        return m_values[idx];
+    }
+
+    return m_invalidValue;
+}
+
+/*! Returns the start position of \p key in the value table, \p mask is the table size - 1.
+ */
+static size_t valueSlotHash(quint32 key, size_t mask)
+{
+    key ^= key >> 16;
+    key *= 0x45d9f3bu;
+    key ^= key >> 16;
+    return key & mask;
+}
+
+/*! Returns the index of the value with the packed \p key in m_values or -1 if not found.
+    \param key - (clusterId << 16) | attributeId
+ */
+int RestNodeBase::valueIndex(quint32 key) const
+{
+    if (m_valueSlots.empty())
+    {
+        return -1;
+    }
 
-    for (; i != end; ++i)
+    const size_t mask = m_valueSlots.size() - 1;
+    for (size_t pos = valueSlotHash(key, mask); ; pos = (pos + 1) & mask) // linear probing
     {
-        if (i->clusterId == clusterId &&
-            i->attributeId == attributeId)
+        const int idx = m_valueSlots[pos];
+        if (idx < 0)
         {
-            return *i;
+            return -1;
+        }
+
+        const NodeValue &val = m_values[idx];
+        if (((quint32(val.clusterId) << 16) | val.attributeId) == key)
+        {
+            return idx;
         }
     }
+}
 
-    return m_invalidValue;
+/*! Stores \p idx in the first free slot for \p key.
+ */
+static void placeValueSlot(std::vector<int> &table, quint32 key, int idx)
+{
+    const size_t mask = table.size() - 1;
+    size_t pos = valueSlotHash(key, mask);
+    while (table[pos] >= 0)
+    {
+        pos = (pos + 1) & mask;
+    }
+    table[pos] = idx;
+}
+
+/*! Adds m_values[\p idx] with the packed \p key to the value table.
+    The table size is a power of two and kept at most half full, so probes stay short
+    and there is always a free slot which terminates a lookup.
+ */
+void RestNodeBase::insertValueIndex(quint32 key, int idx)
+{
+    if (m_values.size() * 2 > m_valueSlots.size())
+    {
+        m_valueSlots.assign(m_valueSlots.empty() ? 16 : m_valueSlots.size() * 2, -1);
+
+        for (size_t i = 0; i < m_values.size(); i++)
+        {
+            if ((int)i != idx)
+            {
+                const NodeValue &val = m_values[i];
+                placeValueSlot(m_valueSlots, (quint32(val.clusterId) << 16) | val.attributeId, i);
+            }
+        }
+    }
+
+    placeValueSlot(m_valueSlots, key, idx);
 }
@@ -13,6 +13,7 @@
 
 #include <QTime>
 #include <deconz.h>
+#include "resource.h"
 
 /*! \class NodeValue
 
@@ -31,9 +32,9 @@ public:
         value.u64 = 0;
     }
 
-    QTime timestamp;
-    QTime timestampLastReport;
-    QTime timestampLastReadRequest;
+    SteadyTimeRef timestamp;
+    SteadyTimeRef timestampLastReport;
+    SteadyTimeRef timestampLastReadRequest;
     UpdateType updateType;
     quint16 clusterId;
     quint16 attributeId;
@@ -77,6 +78,9 @@ public:
     NodeValue &getZclValue(quint16 clusterId, quint16 attributeId);
 
 private:
+    int valueIndex(quint32 key) const;
+    void insertValueIndex(quint32 key, int idx);
+
     deCONZ::Node *m_node;
     deCONZ::Address m_addr;
     QString m_id;
@@ -91,7 +95,8 @@ private:
     std::vector<QTime> m_nextReadTime;
 
     NodeValue m_invalidValue;
-    std::vector<NodeValue> m_values;
+    std::vector<NodeValue> m_values; // in insertion order
+    std::vector<int> m_valueSlots; // open addressing table (cluster << 16 | attribute) --> index in m_values or -1
     QTime m_invalidTime;
 };
 
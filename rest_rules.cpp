@@ -67,9 +67,14 @@ int DeRestPluginPrivate::handleRulesApi(const ApiRequest &req, ApiResponse &rsp)
  */
 int DeRestPluginPrivate::getAllRules(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req);
     rsp.httpStatus = HttpStatusOk;
 
+    // handle ETag
+    if (checkEtag(req, rsp, gwRulesEtag))
+    {
+        return REQ_READY_SEND;
+    }
+
     std::vector<Rule>::const_iterator i = rules.begin();
     std::vector<Rule>::const_iterator end = rules.end();
 
@@ -238,6 +243,118 @@ bool DeRestPluginPrivate::ruleToMap(const Rule *rule, QVariantMap &map)
     return true;
 }
 
+/*! Returns the JSON of a rule as UTF-8.
+    The JSON is cached in the rule and only rebuilt when its version changed.
+ */
+const QByteArray &DeRestPluginPrivate::ruleToJson(Rule *rule)
+{
+    if (rule->version == 0 || rule->jsonVersion != rule->version)
+    {
+        QVariantMap map;
+        if (ruleToMap(rule, map))
+        {
+            rule->json = Json::serialize(map);
+        }
+        else
+        {
+            rule->json.clear();
+        }
+        rule->jsonVersion = rule->version;
+    }
+
+    return rule->json;
+}
+
+/*! Returns the JSON object of all rules as UTF-8, assembled from the cached JSON of each rule.
+ */
+QByteArray DeRestPluginPrivate::rulesToJson()
+{
+    QByteArray json("{");
+
+    std::vector<Rule>::iterator i = rules.begin();
+    std::vector<Rule>::iterator end = rules.end();
+
+    for (; i != end; ++i)
+    {
+        if (i->state() == Rule::StateDeleted)
+        {
+            continue;
+        }
+
+        const QByteArray &rule = ruleToJson(&*i);
+        if (!rule.isEmpty())
+        {
+            if (json.size() > 1)
+            {
+                json += ',';
+            }
+            json += Json::serialize(i->id());
+            json += ':';
+            json += rule;
+        }
+    }
+
+    json += '}';
+    return json;
+}
+
+/*! Returns the rules changed after version \p since as UTF-8 JSON object
+    { "full": false, "changed": { <id>: <rule>, ... }, "deleted": [<id>, ...] }.
+    The rules are taken from the change index, so unchanged rules are not visited.
+    A version which isn't from this run gets all rules with "full": true, the client must
+    then replace its state instead of merging, since deletions of earlier runs aren't listed.
+ */
+QByteArray DeRestPluginPrivate::rulesDeltaToJson(quint64 since)
+{
+    if (since < etagBaseVersion || since > etagVersion)
+    {
+        return "{\"full\":true,\"changed\":" + rulesToJson() + ",\"deleted\":[]}";
+    }
+
+    QByteArray json("{\"full\":false,\"changed\":{");
+    QVariantList deleted;
+
+    QMap<quint64, QString>::const_iterator i = rulesChanges.upperBound(since);
+    QMap<quint64, QString>::const_iterator end = rulesChanges.constEnd();
+
+    for (; i != end; ++i)
+    {
+        if (i.value().isEmpty())
+        {
+            continue;
+        }
+
+        Rule *rule = getRuleForId(i.value());
+        if (rule && rule->version != i.key())
+        {
+            continue; // the id was reused, the current rule has its own entry
+        }
+
+        if (!rule || rule->state() == Rule::StateDeleted)
+        {
+            deleted.append(i.value());
+            continue;
+        }
+
+        const QByteArray itemJson = ruleToJson(rule);
+        if (!itemJson.isEmpty())
+        {
+            if (!json.endsWith('{'))
+            {
+                json += ',';
+            }
+            json += Json::serialize(i.value());
+            json += ':';
+            json += itemJson;
+        }
+    }
+
+    json += "},\"deleted\":";
+    json += Json::serialize(deleted);
+    json += '}';
+    return json;
+}
+
 
 /*! GET /api/<apikey>/rules/<id>
     \return REQ_READY_SEND
@@ -263,6 +380,12 @@ int DeRestPluginPrivate::getRule(const ApiRequest &req, ApiResponse &rsp)
         return REQ_READY_SEND;
     }
 
+    // handle ETag
+    if (checkEtag(req, rsp, rule->etag))
+    {
+        return REQ_READY_SEND;
+    }
+
     std::vector<RuleCondition>::const_iterator c = rule->conditions().begin();
     std::vector<RuleCondition>::const_iterator c_end = rule->conditions().end();
 
@@ -517,7 +640,7 @@ int DeRestPluginPrivate::createRule(const ApiRequest &req, ApiResponse &rsp)
                 return REQ_READY_SEND;
             }
 
-            updateEtag(rule.etag);
+            updateRuleEtag(&rule);
             updateEtag(gwConfigEtag);
 
             {
@@ -818,7 +941,7 @@ int DeRestPluginPrivate::updateRule(const ApiRequest &req, ApiResponse &rsp)
 
     if (changed)
     {
-        updateEtag(rule->etag);
+        updateRuleEtag(rule);
         updateEtag(gwConfigEtag);
         queSaveDb(DB_RULES, DB_SHORT_SAVE_DELAY);
     }
@@ -952,7 +1075,7 @@ int DeRestPluginPrivate::deleteRule(const ApiRequest &req, ApiResponse &rsp)
     rsp.httpStatus = HttpStatusOk;
 
     updateEtag(gwConfigEtag);
-    updateEtag(rule->etag);
+    updateRuleEtag(rule);
 
     queSaveDb(DB_RULES, DB_SHORT_SAVE_DELAY);
 
@@ -1233,12 +1356,13 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
         return;
     }
 
-    QDateTime now = QDateTime::currentDateTime();
+    const QDateTime now = QDateTime::currentDateTime(); // wall clock, only used for time of day conditions
+    const SteadyTimeRef steadyNow = steadyTimeRef();
 
     if (rule.triggerPeriodic() > 0)
     {
-        if (rule.lastTriggered().isValid() &&
-            rule.lastTriggered().addMSecs(rule.triggerPeriodic()) > now)
+        if (rule.lastTriggeredRef.isValid() &&
+            rule.lastTriggeredRef.addMSecs(rule.triggerPeriodic()) > steadyNow)
         {
             // not yet time
             return;
@@ -1252,7 +1376,7 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
     for (; c != cend; ++c)
     {
         Resource *resource = getResource(c->resource(), c->id());
-        ResourceItem *item = resource ? resource->item(c->suffix()) : 0;
+        ResourceItem *item = resource ? resource->item(c->suffixId()) : 0;
 
         if (!resource || !item)
         {
@@ -1269,7 +1393,7 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
         if (resource->prefix() == RSensors)
         {
             if ((idleTotalCounter > (IDLE_READ_LIMIT + 20)) &&
-                item->lastSet() > now.addSecs(0 - (idleTotalCounter - IDLE_READ_LIMIT - 2)))
+                item->lastSet() > steadyNow.addSecs(0 - (idleTotalCounter - IDLE_READ_LIMIT - 2)))
             {
             }
             else
@@ -1302,16 +1426,16 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
         }
         else if (c->op() == RuleCondition::OpDdx)
         {
-            QDateTime dt = item->lastChanged().addSecs(c->seconds());
-            if (dt > now)
+            SteadyTimeRef dt = item->lastChanged().addSecs(c->seconds());
+            if (dt > steadyNow)
             { ok = false; break; } // not time yet
-            else if (rule.lastTriggered().isValid() && rule.lastTriggered() > dt)
+            else if (rule.lastTriggeredRef.isValid() && rule.lastTriggeredRef > dt)
             { ok = false; break; } // already handled
         }
         else if (c->op() == RuleCondition::OpIn)
         {
-            if (rule.lastTriggered().isValid() &&
-                rule.lastTriggered() >= item->lastChanged())
+            if (rule.lastTriggeredRef.isValid() &&
+                rule.lastTriggeredRef >= item->lastChanged())
             { ok = false; break; } // already handled
 
             QTime t = now.time();
@@ -1327,8 +1451,8 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
         }
         else if (c->op() == RuleCondition::OpNotIn)
         {
-            if (rule.lastTriggered().isValid() &&
-                rule.lastTriggered() >= item->lastChanged())
+            if (rule.lastTriggeredRef.isValid() &&
+                rule.lastTriggeredRef >= item->lastChanged())
             { ok = false; break; } // already handled
 
             QTime t = now.time();
@@ -1349,7 +1473,7 @@ void DeRestPluginPrivate::triggerRuleIfNeeded(Rule &rule)
         }
     }
 
-    rule.lastVerify = now;
+    rule.lastVerify = steadyNow;
 
     if (ok)
     {
@@ -1369,6 +1493,7 @@ void DeRestPluginPrivate::triggerRule(Rule &rule)
 
     DBG_Printf(DBG_INFO, "trigger rule %s - %s\n", qPrintable(rule.id()), qPrintable(rule.name()));
 
+    TaskPriorityScope priorityScope(taskPriorityContext, TaskPriorityRule);
     bool triggered = false;
     std::vector<RuleAction>::const_iterator ai = rule.actions().begin();
     std::vector<RuleAction>::const_iterator aend = rule.actions().end();
@@ -1435,8 +1560,9 @@ void DeRestPluginPrivate::triggerRule(Rule &rule)
     if (triggered)
     {
         rule.m_lastTriggered = QDateTime::currentDateTime();
+        rule.lastTriggeredRef = steadyTimeRef();
         rule.setTimesTriggered(rule.timesTriggered() + 1);
-        updateEtag(rule.etag);
+        updateRuleEtag(&rule);
         updateEtag(gwConfigEtag);
         queSaveDb(DB_RULES, DB_HUGE_SAVE_DELAY);
     }
@@ -75,9 +75,14 @@ int DeRestPluginPrivate::handleSchedulesApi(ApiRequest &req, ApiResponse &rsp)
  */
 int DeRestPluginPrivate::getAllSchedules(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req);
     rsp.httpStatus = HttpStatusOk;
 
+    // handle ETag
+    if (checkEtag(req, rsp, gwSchedulesEtag))
+    {
+        return REQ_READY_SEND;
+    }
+
     std::vector<Schedule>::const_iterator i = schedules.begin();
     std::vector<Schedule>::const_iterator end = schedules.end();
 
@@ -184,6 +189,12 @@ int DeRestPluginPrivate::getScheduleAttributes(const ApiRequest &req, ApiRespons
     {
         if (i->id == id)
         {
+            // schedules change in the timer too, only the collection ETag covers all changes
+            if (checkEtag(req, rsp, gwSchedulesEtag))
+            {
+                return REQ_READY_SEND;
+            }
+
             rsp.map["name"] = i->name;
             rsp.map["description"] = i->description;
             rsp.map["command"] = i->jsonMap["command"];
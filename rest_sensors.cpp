@@ -94,49 +94,38 @@ int DeRestPluginPrivate::handleSensorsApi(ApiRequest &req, ApiResponse &rsp)
 }
 
 /*! GET /api/<apikey>/sensors
+    GET /api/<apikey>/sensors?since=<version>
+
+    With since the response is { "sensors": { "full": <bool>, "changed": { ... }, "deleted": [ ... ] },
+    "version": <version> }. "full": true means since wasn't from this run, "changed" then
+    holds all sensors and replaces the client state.
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
  */
 int DeRestPluginPrivate::getAllSensors(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req);
     rsp.httpStatus = HttpStatusOk;
 
     // handle ETag
-    if (req.hdr.hasKey("If-None-Match"))
-    {
-        QString etag = req.hdr.value("If-None-Match");
-
-        if (gwSensorsEtag == etag)
-        {
-            rsp.httpStatus = HttpStatusNotModified;
-            rsp.etag = etag;
-            return REQ_READY_SEND;
-        }
-    }
-
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
-
-    for (; i != end; ++i)
+    if (checkEtag(req, rsp, gwSensorsEtag))
     {
-        // ignore deleted sensors
-        if (i->deletedState() == Sensor::StateDeleted)
-        {
-            continue;
-        }
-
-        QVariantMap map;
-        sensorToMap(&*i, map);
-        rsp.map[i->id()] = map;
+        return REQ_READY_SEND;
     }
 
-    if (rsp.map.isEmpty())
+    // delta request
+    quint64 since;
+    if (sinceVersion(req, &since))
     {
-        rsp.str = "{}"; // return empty object
+        QByteArray json("{\"sensors\":");
+        json += sensorsDeltaToJson(since);
+        json += ",\"version\":";
+        json += QByteArray::number(etagVersion);
+        json += '}';
+        rsp.str = QString::fromUtf8(json);
+        return REQ_READY_SEND;
     }
 
-    rsp.etag = gwSensorsEtag;
+    rsp.str = QString::fromUtf8(sensorsToJson());
 
     return REQ_READY_SEND;
 }
@@ -167,21 +156,13 @@ int DeRestPluginPrivate::getSensor(const ApiRequest &req, ApiResponse &rsp)
     }
 
     // handle ETag
-    if (req.hdr.hasKey("If-None-Match"))
+    if (checkEtag(req, rsp, sensor->etag))
     {
-        QString etag = req.hdr.value("If-None-Match");
-
-        if (sensor->etag == etag)
-        {
-            rsp.httpStatus = HttpStatusNotModified;
-            rsp.etag = etag;
-            return REQ_READY_SEND;
-        }
+        return REQ_READY_SEND;
     }
 
     sensorToMap(sensor, rsp.map);
     rsp.httpStatus = HttpStatusOk;
-    rsp.etag = sensor->etag;
 
     return REQ_READY_SEND;
 }
@@ -262,8 +243,8 @@ int DeRestPluginPrivate::createSensor(const ApiRequest &req, ApiResponse &rsp)
 
         do {
             ok = true;
-            std::vector<Sensor>::const_iterator i = sensors.begin();
-            std::vector<Sensor>::const_iterator end = sensors.end();
+            SlotMap<Sensor>::const_iterator i = sensors.begin();
+            SlotMap<Sensor>::const_iterator end = sensors.end();
 
             for (; i != end; ++i)
             {
@@ -505,6 +486,7 @@ int DeRestPluginPrivate::createSensor(const ApiRequest &req, ApiResponse &rsp)
         updateSensorEtag(&sensor);
         sensor.setNeedSaveDatabase(true);
         sensors.push_back(sensor);
+        indexSensorNode(&sensors.back());
         queSaveDb(DB_SENSORS, DB_SHORT_SAVE_DELAY);
 
         rspItemState["id"] = sensor.id();
@@ -647,7 +629,7 @@ int DeRestPluginPrivate::updateSensor(const ApiRequest &req, ApiResponse &rsp)
             rspItemState[QString("/sensors/%1/mode:").arg(id)] = (double)mode;
             rspItem["success"] = rspItemState;
             rsp.list.append(rspItem);
-            updateEtag(sensor->etag);
+            updateSensorEtag(sensor);
             updateEtag(gwConfigEtag);
             queSaveDb(DB_SENSORS | DB_GROUPS, DB_SHORT_SAVE_DELAY);
         }
@@ -900,6 +882,7 @@ int DeRestPluginPrivate::deleteSensor(const ApiRequest &req, ApiResponse &rsp)
 
     sensor->setDeletedState(Sensor::StateDeleted);
     sensor->setNeedSaveDatabase(true);
+    updateSensorEtag(sensor);
 
     Event e(RSensors, REventDeleted, sensor->id());
     enqueueEvent(e);
@@ -1081,6 +1064,120 @@ bool DeRestPluginPrivate::sensorToMap(const Sensor *sensor, QVariantMap &map)
     return true;
 }
 
+/*! Returns the JSON of a sensor as UTF-8.
+    The JSON is cached in the sensor and only rebuilt when its version or one of its items changed.
+ */
+const QByteArray &DeRestPluginPrivate::sensorToJson(Sensor *sensor)
+{
+    const quint64 changeSeq = sensor->changeSeq();
+    if (sensor->version == 0 || sensor->jsonVersion != sensor->version || sensor->jsonChangeSeq != changeSeq)
+    {
+        QVariantMap map;
+        if (sensorToMap(sensor, map))
+        {
+            sensor->json = Json::serialize(map);
+        }
+        else
+        {
+            sensor->json.clear();
+        }
+        sensor->jsonVersion = sensor->version;
+        sensor->jsonChangeSeq = changeSeq;
+    }
+
+    return sensor->json;
+}
+
+/*! Returns the JSON object of all sensors as UTF-8, assembled from the cached JSON of each sensor.
+ */
+QByteArray DeRestPluginPrivate::sensorsToJson()
+{
+    QByteArray json("{");
+
+    SlotMap<Sensor>::iterator i = sensors.begin();
+    SlotMap<Sensor>::iterator end = sensors.end();
+
+    for (; i != end; ++i)
+    {
+        if (i->deletedState() == Sensor::StateDeleted)
+        {
+            continue;
+        }
+
+        const QByteArray &sensor = sensorToJson(&*i);
+        if (!sensor.isEmpty())
+        {
+            if (json.size() > 1)
+            {
+                json += ',';
+            }
+            json += Json::serialize(i->id());
+            json += ':';
+            json += sensor;
+        }
+    }
+
+    json += '}';
+    return json;
+}
+
+/*! Returns the sensors changed after version \p since as UTF-8 JSON object
+    { "full": false, "changed": { <id>: <sensor>, ... }, "deleted": [<id>, ...] }.
+    The sensors are taken from the change index, so unchanged sensors are not visited.
+    A version which isn't from this run gets all sensors with "full": true, the client must
+    then replace its state instead of merging, since deletions of earlier runs aren't listed.
+ */
+QByteArray DeRestPluginPrivate::sensorsDeltaToJson(quint64 since)
+{
+    if (since < etagBaseVersion || since > etagVersion)
+    {
+        return "{\"full\":true,\"changed\":" + sensorsToJson() + ",\"deleted\":[]}";
+    }
+
+    QByteArray json("{\"full\":false,\"changed\":{");
+    QVariantList deleted;
+
+    QMap<quint64, QString>::const_iterator i = sensorsChanges.upperBound(since);
+    QMap<quint64, QString>::const_iterator end = sensorsChanges.constEnd();
+
+    for (; i != end; ++i)
+    {
+        if (i.value().isEmpty())
+        {
+            continue;
+        }
+
+        Sensor *sensor = getSensorNodeForId(i.value());
+        if (sensor && sensor->version != i.key())
+        {
+            continue; // the id was reused, the current sensor has its own entry
+        }
+
+        if (!sensor || sensor->deletedState() == Sensor::StateDeleted)
+        {
+            deleted.append(i.value());
+            continue;
+        }
+
+        const QByteArray itemJson = sensorToJson(sensor);
+        if (!itemJson.isEmpty())
+        {
+            if (!json.endsWith('{'))
+            {
+                json += ',';
+            }
+            json += Json::serialize(i.value());
+            json += ':';
+            json += itemJson;
+        }
+    }
+
+    json += "},\"deleted\":";
+    json += Json::serialize(deleted);
+    json += '}';
+    return json;
+}
+
 void DeRestPluginPrivate::handleSensorEvent(const Event &e)
 {
     DBG_Assert(e.resource() == RSensors);
@@ -1105,7 +1202,7 @@ void DeRestPluginPrivate::handleSensorEvent(const Event &e)
             map["r"] = QLatin1String("sensors");
             map["id"] = e.id();
             QVariantMap state;
-            state[e.what() + 6] = item->toVariant();
+            state[e.what() + 6] = e.value().isValid() ? e.value() : item->toVariant(); // value when queued
 
             item = sensor->item(RStateLastUpdated);
             if (item)
@@ -1115,7 +1212,8 @@ void DeRestPluginPrivate::handleSensorEvent(const Event &e)
 
             map["state"] = state;
 
-            webSocketServer->broadcastTextMessage(Json::serialize(map));
+            // transitions like button events must not be coalesced for slow clients
+            webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("sensors"), e.id(), e.what() + 6, !isTransitionEvent(e.what()));
         }
     }
     else if (e.what() == REventAdded)
@@ -1152,7 +1250,7 @@ void DeRestPluginPrivate::handleSensorEvent(const Event &e)
         smap["id"] = sensor->id();
         map["sensor"] = smap;
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("sensors"), sensor->id());
     }
     else if (e.what() == REventDeleted)
     {
@@ -1167,7 +1265,7 @@ void DeRestPluginPrivate::handleSensorEvent(const Event &e)
         smap["id"] = e.id();
         map["sensor"] = smap;
 
-        webSocketServer->broadcastTextMessage(Json::serialize(map));
+        webSocketServer->broadcastTextMessage(Json::serialize(map), QLatin1String("sensors"), e.id());
     }
     else if (e.what() == REventValidGroup)
     {
@@ -1282,13 +1380,13 @@ void DeRestPluginPrivate::checkSensorStateTimerFired()
             max = dur->toNumber();
         }
 
-        QDateTime now = QDateTime::currentDateTime();
-        int dt = item->lastSet().secsTo(now);
+        int dt = item->lastSet().secsTo(steadyTimeRef());
 
         if (!item->lastSet().isValid() || !(dt >= 0 && dt <= max))
         {
             DBG_Printf(DBG_INFO, "sensor %s (%s): disable presence after %d seconds\n", qPrintable(sensor->id()), qPrintable(sensor->modelId()), dt);
             item->setValue(false);
+            updateSensorEtag(sensor);
             Event e(RSensors, RStatePresence, sensor->id());
             enqueueEvent(e);
         }
@@ -1670,6 +1768,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                 sensorNode.setNeedSaveDatabase(true);
                 sensors.push_back(sensorNode);
                 s1 = &sensors.back();
+                indexSensorNode(s1);
                 updateSensorEtag(s1);
                 update = true;
                 Event e(RSensors, REventAdded, sensorNode.id());
@@ -1688,6 +1787,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                     sensorNode.setNeedSaveDatabase(true);
                     sensors.push_back(sensorNode);
                     s1 = &sensors.back();
+                    indexSensorNode(s1);
                     updateSensorEtag(s1);
                     update = true;
                     Event e(RSensors, REventAdded, sensorNode.id());
@@ -1706,6 +1806,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                     sensorNode.setUniqueId(generateUniqueId(sensorNode.address().ext(), sensorNode.fingerPrint().endpoint, COMMISSIONING_CLUSTER_ID));
                     sensors.push_back(sensorNode);
                     s2 = &sensors.back();
+                    indexSensorNode(s2);
                     updateSensorEtag(s2);
                     update = true;
                     Event e(RSensors, REventAdded, sensorNode.id());
@@ -1895,6 +1996,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                 sensorNode.setName(QString("Remote control %1").arg(sensorNode.id()));
                 sensors.push_back(sensorNode);
                 s = &sensors.back();
+                indexSensorNode(s);
                 updateSensorEtag(s);
                 Event e(RSensors, REventAdded, sensorNode.id());
                 enqueueEvent(e);
@@ -1949,6 +2051,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                         {
                             DBG_Printf(DBG_INFO, "ikea remote delete old rule %s\n", qPrintable(ri->name()));
                             ri->setState(Rule::StateDeleted);
+                            updateRuleEtag(&*ri);
                         }
                         else
                         {
@@ -1971,7 +2074,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                 RuleAction a;
                 r.setOwner(QLatin1String("deCONZ"));
                 r.setCreationtime(QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddTHH:mm:ss"));
-                updateEtag(r.etag);
+                updateRuleEtag(&r);
 
                 int ruleId = 1;
                 r.setId(QString::number(ruleId));
@@ -2013,7 +2116,7 @@ void DeRestPluginPrivate::handleIndicationFindSensors(const deCONZ::ApsDataIndic
                 // ww rule
                 ruleId++;
                 r.setId(QString::number(ruleId));
-                updateEtag(r.etag);
+                updateRuleEtag(&r);
 
                 while (std::find_if(rules.begin(), rules.end(),
                           [&r](Rule &r2) { return r2.id() == r.id(); }) != rules.end())
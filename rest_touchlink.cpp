@@ -667,8 +667,8 @@ void DeRestPluginPrivate::sendTouchlinkConfirm(deCONZ::TouchlinkStatus status)
             // mark the reset node as not available
             if (touchlinkState == TL_SendingResetRequest)
             {
-                std::vector<LightNode>::iterator i = nodes.begin();
-                std::vector<LightNode>::iterator end = nodes.end();
+                SlotMap<LightNode>::iterator i = nodes.begin();
+                SlotMap<LightNode>::iterator end = nodes.end();
 
                 for (; i != end; ++i)
                 {
@@ -676,7 +676,7 @@ void DeRestPluginPrivate::sendTouchlinkConfirm(deCONZ::TouchlinkStatus status)
                     {
                         // TODO: remove the node from groups
                         i->item(RStateReachable)->setValue(false);
-                        updateEtag(i->etag);
+                        updateLightEtag(&*i);
                         updateEtag(gwConfigEtag);
                     }
                 }
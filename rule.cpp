@@ -22,6 +22,8 @@ Rule::Rule() :
     m_owner("notSet"),
     m_status("enabled")
 {
+    version = 0;
+    jsonVersion = 0;
 }
 
 /*! Returns the rule state.
@@ -367,6 +369,7 @@ const QString &RuleAction::body() const
 
 // Condition
 RuleCondition::RuleCondition() :
+    m_suffixId(RIdInvalid),
     m_op(OpUnknown),
     m_num(0)
 {
@@ -375,6 +378,7 @@ RuleCondition::RuleCondition() :
 RuleCondition::RuleCondition(const QVariantMap &map) :
     m_prefix(0),
     m_suffix(0),
+    m_suffixId(RIdInvalid),
     m_num(0)
 {
     bool ok;
@@ -419,6 +423,7 @@ RuleCondition::RuleCondition(const QVariantMap &map) :
 
     m_suffix = getResourceItemDescriptor(m_address, rid) ? rid.suffix
                                                          : RInvalidSuffix;
+    m_suffixId = rid.suffixId;
 
     if (m_operator == QLatin1String("eq")) { m_op = OpEqual; }
     else if (m_operator == QLatin1String("gt")) { m_op = OpGreaterThan; }
@@ -610,6 +615,13 @@ const char *RuleCondition::suffix() const
     return m_suffix;
 }
 
+/*! Returns the resolved suffix id for fast item lookup.
+ */
+ResourceSuffixId RuleCondition::suffixId() const
+{
+    return m_suffixId;
+}
+
 /*! Returns true if two BindingTasks are equal.
  */
 bool BindingTask::operator==(const BindingTask &rhs) const
@@ -121,7 +121,11 @@ public:
     static std::vector<RuleCondition> jsonToConditions(const QString &json);
 
     QString etag;
-    QDateTime lastVerify;
+    quint64 version; // bumped with the etag, see DeRestPluginPrivate::updateEtag()
+    QByteArray json; // cached REST API JSON, see DeRestPluginPrivate::ruleToJson()
+    quint64 jsonVersion; // version of the cached JSON
+    SteadyTimeRef lastVerify;
+    SteadyTimeRef lastTriggeredRef; // monotonic copy of m_lastTriggered for rule evaluation
     QDateTime m_lastTriggered;
     int lastBindingVerify; // copy of idleTotalCounter at last binding verification
 
@@ -193,6 +197,7 @@ public:
     const QTime &time1() const;
     const char *resource() const;
     const char *suffix() const;
+    ResourceSuffixId suffixId() const;
 
 private:
     QString m_address;
@@ -202,6 +207,7 @@ private:
     // internal calculated values for faster access
     const char *m_prefix;
     const char *m_suffix;
+    ResourceSuffixId m_suffixId;
     QString m_id;
     Operator m_op;
     int m_num;
@@ -356,6 +356,10 @@ Sensor::Sensor() :
     m_resetRetryCount(0),
     m_buttonMap(0)
 {
+    version = 0;
+    jsonVersion = 0;
+    jsonChangeSeq = 0;
+
     // common sensor items
     addItem(DataTypeBool, RConfigOn);
     addItem(DataTypeBool, RConfigReachable);
@@ -482,7 +486,7 @@ void Sensor::updateStateTimestamp()
     ResourceItem *i = item(RStateLastUpdated);
     if (i)
     {
-        i->setValue(QDateTime::currentDateTimeUtc());
+        i->setValue(QDateTime::currentMSecsSinceEpoch());
     }
 }
 
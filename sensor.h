@@ -124,6 +124,10 @@ public:
     const SensorFingerprint &fingerPrint() const;
 
     QString etag;
+    quint64 version; // bumped with the etag, see DeRestPluginPrivate::updateEtag()
+    QByteArray json; // cached REST API JSON, see DeRestPluginPrivate::sensorToJson()
+    quint64 jsonVersion; // version of the cached JSON
+    quint64 jsonChangeSeq; // Resource::changeSeq() of the cached JSON
     const ButtonMap *buttonMap();
 
 private:
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <QtGlobal>
+#include <vector>
+
+/*! \class SlotMapIterator
+
+    Iterator over the slots of a SlotMap in insertion order.
+ */
+template <typename M, typename V>
+class SlotMapIterator
+{
+public:
+    SlotMapIterator() : m_map(0), m_slot(0) { }
+    SlotMapIterator(M *map, size_t slot) : m_map(map), m_slot(slot) { }
+    // allows iterator to const_iterator conversion
+    template <typename M2, typename V2>
+    SlotMapIterator(const SlotMapIterator<M2, V2> &other) : m_map(other.map()), m_slot(other.slot()) { }
+
+    V &operator*() const { return (*m_map)[m_slot]; }
+    V *operator->() const { return &(*m_map)[m_slot]; }
+    SlotMapIterator &operator++() { ++m_slot; return *this; }
+    SlotMapIterator operator++(int) { SlotMapIterator i = *this; ++m_slot; return i; }
+    SlotMapIterator &operator--() { --m_slot; return *this; }
+    SlotMapIterator operator--(int) { SlotMapIterator i = *this; --m_slot; return i; }
+    bool operator==(const SlotMapIterator &other) const { return m_slot == other.m_slot; }
+    bool operator!=(const SlotMapIterator &other) const { return m_slot != other.m_slot; }
+
+    M *map() const { return m_map; }
+    size_t slot() const { return m_slot; }
+
+private:
+    M *m_map;
+    size_t m_slot;
+};
+
+/*! \class SlotMap
+
+    Container with stable element addresses.
+
+    Elements are stored in fixed size chunks which are never reallocated,
+    so pointers and references to elements stay valid when the container grows.
+    Iteration walks the slots in insertion order across the chunks.
+
+    Address stability is the only guarantee and it is sufficient: lights and sensors
+    are never erased, deleted ones only change their state, so a cached pointer
+    always refers to the same element for the lifetime of the plugin. There are no
+    handles, since a slot is never reused for another element.
+ */
+template <typename T, size_t ChunkSize = 64>
+class SlotMap
+{
+public:
+    typedef SlotMapIterator<SlotMap, T> iterator;
+    typedef SlotMapIterator<const SlotMap, const T> const_iterator;
+
+    SlotMap() : m_size(0) { }
+    ~SlotMap() { clear(); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_size); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    T &operator[](size_t slot) { return (*m_chunks[slot / ChunkSize])[slot % ChunkSize]; }
+    const T &operator[](size_t slot) const { return (*m_chunks[slot / ChunkSize])[slot % ChunkSize]; }
+    T &back() { return (*this)[m_size - 1]; }
+    const T &back() const { return (*this)[m_size - 1]; }
+
+    /*! Appends a copy of \p value. */
+    void push_back(const T &value)
+    {
+        if (m_chunks.empty() || m_chunks.back()->size() == ChunkSize)
+        {
+            m_chunks.push_back(new std::vector<T>);
+            m_chunks.back()->reserve(ChunkSize); // never grows beyond, so never reallocates
+        }
+
+        m_chunks.back()->push_back(value);
+        m_size++;
+    }
+
+    /*! Looks up the slot of the element at address \p value.
+        \return true if \p value is an element of this container
+     */
+    bool slotOf(const T *value, size_t *slot) const
+    {
+        for (size_t c = 0; c < m_chunks.size(); c++)
+        {
+            const std::vector<T> &chunk = *m_chunks[c];
+            if (!chunk.empty() && value >= &chunk.front() && value <= &chunk.back())
+            {
+                *slot = c * ChunkSize + (value - &chunk.front());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*! Removes all elements. */
+    void clear()
+    {
+        for (size_t c = 0; c < m_chunks.size(); c++)
+        {
+            delete m_chunks[c];
+        }
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+private:
+    Q_DISABLE_COPY(SlotMap)
+
+    size_t m_size;
+    std::vector<std::vector<T>*> m_chunks;
+};
+
+#endif // SLOT_MAP_H
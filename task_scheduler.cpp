@@ -0,0 +1,985 @@
+/*
+ * Copyright (c) 2017 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QDataStream>
+#include <QSet>
+#include <algorithm>
+#include "de_web_plugin_private.h"
+
+/*! Result of DeRestPluginPrivate::sendTask(). */
+enum TaskSendResult
+{
+    TaskSent,
+    TaskDeferred,
+    TaskDropped
+};
+
+/*! Constructor.
+    \param initial - initial window size
+    \param max - upper bound of the window size
+ */
+TaskWindow::TaskWindow(double initial, double max) :
+    window(initial),
+    maxWindow(max),
+    onAir(0),
+    srtt(0),
+    rttvar(0),
+    confirms(0),
+    errors(0),
+    timeouts(0)
+{
+}
+
+/*! Returns the time in ms to wait for the confirm of a request.
+ */
+int TaskWindow::timeout() const
+{
+    if (srtt == 0)
+    {
+        return TASK_TIMEOUT_INITIAL;
+    }
+
+    return qBound(TASK_TIMEOUT_MIN, srtt + 4 * rttvar, TASK_TIMEOUT_MAX);
+}
+
+/*! Additive increase after a successful confirm.
+    \param rtt - round trip time of the request in ms
+ */
+void TaskWindow::confirmed(int rtt)
+{
+    if (onAir > 0)
+    {
+        onAir--;
+    }
+
+    if (srtt == 0)
+    {
+        srtt = rtt;
+        rttvar = rtt / 2;
+    }
+    else
+    {
+        rttvar = (3 * rttvar + qAbs(srtt - rtt)) / 4;
+        srtt = (7 * srtt + rtt) / 8;
+    }
+
+    window = qMin(maxWindow, window + 1.0 / window);
+    confirms++;
+}
+
+/*! Multiplicative decrease after a failed or timed out request.
+    \param timedOut - true if no confirm was received
+ */
+void TaskWindow::failed(bool timedOut)
+{
+    if (onAir > 0)
+    {
+        onAir--;
+    }
+
+    window = qMax(double(TASK_WINDOW_MIN), window / 2);
+
+    if (timedOut)
+    {
+        timeouts++;
+    }
+    else
+    {
+        errors++;
+    }
+}
+
+/*! Refills the bucket and returns true if a token is available.
+    \param now - current time
+ */
+bool TokenBucket::isAvailable(const SteadyTimeRef &now)
+{
+    if (interval <= 0)
+    {
+        tokens = capacity;
+    }
+    else if (lastRefill.isValid())
+    {
+        tokens = qMin(capacity, tokens + double(lastRefill.msecsTo(now)) / interval);
+    }
+    lastRefill = now;
+
+    return tokens >= 1;
+}
+
+/*! Returns the destination key of an APS request.
+ */
+static TaskDstKey taskDstKey(const deCONZ::ApsDataRequest &req)
+{
+    if (req.dstAddressMode() == deCONZ::ApsGroupAddress)
+    {
+        return TaskDstKey(deCONZ::ApsGroupAddress, req.dstAddress().group());
+    }
+    else if (req.dstAddress().hasExt())
+    {
+        return TaskDstKey(deCONZ::ApsExtAddress, req.dstAddress().ext());
+    }
+    return TaskDstKey(deCONZ::ApsNwkAddress, req.dstAddress().nwk());
+}
+
+/*! Returns true if the task type is a query which may wait behind commands.
+ */
+static bool isBackgroundTask(TaskType taskType)
+{
+    switch (taskType)
+    {
+    case TaskGetHue:
+    case TaskGetColor:
+    case TaskGetSat:
+    case TaskGetLevel:
+    case TaskGetOnOff:
+    case TaskGetColorLoop:
+    case TaskReadAttributes:
+    case TaskGetGroupMembership:
+    case TaskGetGroupIdentifiers:
+    case TaskGetSceneMembership:
+    case TaskViewScene:
+    case TaskViewGroup:
+        return true;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/*! Returns true if a queued task of the same type and destination may be replaced by a newer one.
+ */
+static bool isReplaceableTask(TaskType taskType)
+{
+    switch (taskType)
+    {
+    case TaskGetSceneMembership:
+    case TaskGetGroupMembership:
+    case TaskGetGroupIdentifiers:
+    case TaskStoreScene:
+    case TaskRemoveScene:
+    case TaskRemoveAllScenes:
+    case TaskReadAttributes:
+    case TaskWriteAttribute:
+    case TaskViewScene:
+    case TaskAddScene:
+        return false;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+/*! Serializes the ZCL frame of a task into its APS request.
+ */
+static void updateTaskAsdu(TaskItem &task)
+{
+    task.req.asdu().clear();
+    QDataStream stream(&task.req.asdu(), QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    task.zclFrame.writeToStream(stream);
+}
+
+/*! Returns the queued task of \p taskType with the same destination and endpoint as \p task.
+    \return the task or tasks.end() if not found
+ */
+std::list<TaskItem>::iterator DeRestPluginPrivate::findQueuedTask(const TaskItem &task, quint16 clusterId, TaskType taskType)
+{
+    const TaskDedupeKey dedupeKey(taskDstKey(task.req), task.req.dstEndpoint(), clusterId, taskType);
+    QHash<TaskDedupeKey, std::list<TaskItem>::iterator>::iterator h = taskDedupe.find(dedupeKey);
+
+    if (h == taskDedupe.end())
+    {
+        return tasks.end();
+    }
+
+    const TaskItem &queued = *h.value();
+    if ((queued.req.srcEndpoint() != task.req.srcEndpoint()) ||
+        (queued.req.profileId() != task.req.profileId()) ||
+        (queued.req.txOptions() != task.req.txOptions()))
+    {
+        return tasks.end();
+    }
+
+    return h.value();
+}
+
+/*! Replaces a queued task with \p task, the queue position is kept.
+    The queue time is restarted since the task now carries a new command.
+ */
+void DeRestPluginPrivate::replaceQueuedTask(std::list<TaskItem>::iterator i, const TaskItem &task)
+{
+    const TaskDedupeKey oldKey(taskDstKey(i->req), i->req.dstEndpoint(), i->req.clusterId(), i->taskType);
+    QHash<TaskDedupeKey, std::list<TaskItem>::iterator>::iterator h = taskDedupe.find(oldKey);
+    if (h != taskDedupe.end() && h.value() == i)
+    {
+        taskDedupe.erase(h);
+    }
+
+    const TaskPriority priority = i->priority;
+    *i = task;
+    i->priority = priority;
+    i->queueTime = steadyTimeRef();
+
+    taskDedupe.insert(TaskDedupeKey(taskDstKey(i->req), i->req.dstEndpoint(), i->req.clusterId(), i->taskType), i);
+}
+
+/*! Completes a unicast \p address which only carries the network address with the
+    extended address of the light or sensor, so all tasks towards a device share one key.
+ */
+void DeRestPluginPrivate::resolveTaskDstAddress(deCONZ::Address &address)
+{
+    if (address.hasExt() || !address.hasNwk())
+    {
+        return;
+    }
+
+    const LightNode *lightNode = getLightNodeForAddress(address);
+    if (lightNode && lightNode->address().hasExt())
+    {
+        address.setExt(lightNode->address().ext());
+        return;
+    }
+
+    const Sensor *sensor = getSensorNodeForAddress(address);
+    if (sensor && sensor->address().hasExt())
+    {
+        address.setExt(sensor->address().ext());
+    }
+}
+
+/*! Removes the destination \p d once it has neither queued nor running tasks.
+ */
+void DeRestPluginPrivate::pruneTaskDestination(QHash<TaskDstKey, TaskDestinationQueue>::iterator d)
+{
+    if (d == taskDestinations.end() || d->queued() > 0 || d->window.onAir > 0)
+    {
+        return;
+    }
+
+    for (int p = 0; p < TaskPriorityMax; p++)
+    {
+        if (d->ready[p])
+        {
+            return; // still listed in taskReady[p], pruned when visited
+        }
+    }
+
+    taskDestinations.erase(d);
+}
+
+/*! Removes a queued task from its destination queue and the storage.
+ */
+void DeRestPluginPrivate::removeQueuedTask(std::list<TaskItem>::iterator i)
+{
+    QHash<TaskDstKey, TaskDestinationQueue>::iterator d = taskDestinations.find(taskDstKey(i->req));
+    if (d != taskDestinations.end())
+    {
+        std::deque<std::list<TaskItem>::iterator> &queue = d->queue[i->priority];
+        std::deque<std::list<TaskItem>::iterator>::iterator q = std::find(queue.begin(), queue.end(), i);
+        if (q != queue.end())
+        {
+            queue.erase(q);
+        }
+    }
+
+    dequeueTask(i);
+}
+
+/*! Merges a light state command into the queued commands of the same destination.
+
+    Only the latest target per on/off, level and color is kept:
+    - an absolute color command (xy, ct, hue and saturation) replaces all queued color commands
+    - Move to level (with on/off) replaces queued level and on/off commands
+    - Move to level is turned into Move to level (with on/off) when it replaces such a command
+    - On is dropped while a queued Move to level (with on/off) switches the light on anyway
+    - Off turns a queued Move to level (with on/off) into Move to level
+
+    \return true - if \p task was merged into the queue and must not be added
+ */
+bool DeRestPluginPrivate::coalesceTask(const TaskItem &task)
+{
+    const quint8 commandId = task.zclFrame.commandId();
+
+    if (task.taskType == TaskSetXyColor || task.taskType == TaskSetColorTemperature || task.taskType == TaskSetHueAndSaturation)
+    {
+        const TaskType colorTypes[] = { TaskSetXyColor, TaskSetColorTemperature, TaskSetHueAndSaturation, TaskSetEnhancedHue, TaskSetSat };
+        std::list<TaskItem>::iterator keep = tasks.end();
+
+        for (size_t n = 0; n < sizeof(colorTypes) / sizeof(colorTypes[0]); n++)
+        {
+            std::list<TaskItem>::iterator i = findQueuedTask(task, COLOR_CLUSTER_ID, colorTypes[n]);
+            if (i == tasks.end())
+            {
+                continue;
+            }
+
+            if (keep == tasks.end())
+            {
+                keep = i;
+            }
+            else
+            {
+                removeQueuedTask(i);
+            }
+        }
+
+        if (keep != tasks.end())
+        {
+            DBG_Printf(DBG_INFO_L2, "coalesce color command 0x%02X into queued task\n", commandId);
+            replaceQueuedTask(keep, task);
+            return true;
+        }
+    }
+    else if (task.taskType == TaskSetLevel)
+    {
+        std::list<TaskItem>::iterator level = findQueuedTask(task, LEVEL_CLUSTER_ID, TaskSetLevel);
+
+        if (commandId == 0x04) // Move to level (with on/off)
+        {
+            std::list<TaskItem>::iterator onOff = findQueuedTask(task, ONOFF_CLUSTER_ID, TaskSendOnOffToggle);
+            if (onOff != tasks.end() &&
+                onOff->zclFrame.commandId() != ONOFF_COMMAND_ON && onOff->zclFrame.commandId() != ONOFF_COMMAND_OFF)
+            {
+                onOff = tasks.end(); // toggle and timed commands stay as they are
+            }
+
+            if (level == tasks.end())
+            {
+                level = onOff;
+            }
+            else if (onOff != tasks.end())
+            {
+                removeQueuedTask(onOff);
+            }
+
+            if (level != tasks.end())
+            {
+                DBG_Printf(DBG_INFO_L2, "coalesce level command into queued task\n");
+                replaceQueuedTask(level, task);
+                return true;
+            }
+        }
+        else if (level != tasks.end() && level->zclFrame.commandId() == 0x04)
+        {
+            TaskItem merged = task;
+            merged.zclFrame.setCommandId(0x04); // keep switching the light on
+            updateTaskAsdu(merged);
+            replaceQueuedTask(level, merged);
+            return true;
+        }
+    }
+    else if (task.taskType == TaskSendOnOffToggle)
+    {
+        std::list<TaskItem>::iterator level = findQueuedTask(task, LEVEL_CLUSTER_ID, TaskSetLevel);
+
+        if (level != tasks.end() && level->zclFrame.commandId() == 0x04)
+        {
+            if (commandId == ONOFF_COMMAND_ON && level->level > 0)
+            {
+                DBG_Printf(DBG_INFO_L2, "drop on command, queued level command switches on\n");
+                return true;
+            }
+            else if (commandId == ONOFF_COMMAND_OFF)
+            {
+                level->zclFrame.setCommandId(0x00); // Move to level
+                updateTaskAsdu(*level);
+            }
+        }
+    }
+
+    return false;
+}
+
+/*! Adds a task to the queue of its destination.
+
+    Light state commands are merged into queued commands of the same destination first,
+    a queued task with the same destination, endpoint, cluster and type is replaced.
+    The task is scheduled with the priority of the current context (REST API or rule),
+    queries are scheduled as background tasks.
+    \return true - on success
+ */
+bool DeRestPluginPrivate::addTask(const TaskItem &item)
+{
+    if (!isInNetwork())
+    {
+        perfCounters().tasksRejected++;
+        return false;
+    }
+
+    TaskItem task = item;
+    if (task.req.dstAddressMode() != deCONZ::ApsGroupAddress)
+    {
+        resolveTaskDstAddress(task.req.dstAddress());
+    }
+
+    if (coalesceTask(task))
+    {
+        perfCounters().tasksCoalesced++;
+        return true;
+    }
+
+    const TaskDstKey dstKey = taskDstKey(task.req);
+    const TaskDedupeKey dedupeKey(dstKey, task.req.dstEndpoint(), task.req.clusterId(), task.taskType);
+    const bool replaceable = isReplaceableTask(task.taskType);
+
+    if (replaceable)
+    {
+        QHash<TaskDedupeKey, std::list<TaskItem>::iterator>::iterator h = taskDedupe.find(dedupeKey);
+        if (h != taskDedupe.end())
+        {
+            TaskItem &queued = *h.value();
+            if ((queued.req.srcEndpoint() == task.req.srcEndpoint()) &&
+                (queued.req.profileId() == task.req.profileId()) &&
+                (queued.req.txOptions() == task.req.txOptions()) &&
+                (queued.req.asdu().size() == task.req.asdu().size()))
+            {
+                DBG_Printf(DBG_INFO, "Replace task in queue cluster 0x%04X with newer task of same type. %d runnig tasks\n", task.req.clusterId(), runningTaskCount);
+                const TaskPriority priority = queued.priority; // keep the position in its queue
+                queued = task;
+                queued.priority = priority;
+                queued.queueTime = steadyTimeRef();
+                perfCounters().tasksCoalesced++;
+                return true;
+            }
+        }
+    }
+
+    QHash<TaskDstKey, TaskDestinationQueue>::iterator d = taskDestinations.find(dstKey);
+
+    if (tasks.size() >= MAX_TASKS || (d != taskDestinations.end() && d->queued() >= MAX_TASKS_PER_DESTINATION))
+    {
+        DBG_Printf(DBG_INFO, "task queue full, drop task cluster 0x%04X\n", task.req.clusterId());
+        perfCounters().tasksRejected++;
+        return false;
+    }
+
+    if (d == taskDestinations.end())
+    {
+        d = taskDestinations.insert(dstKey, TaskDestinationQueue());
+    }
+
+    TaskDestinationQueue &dst = d.value();
+
+    tasks.push_back(task);
+    std::list<TaskItem>::iterator i = tasks.end();
+    --i;
+    i->queueTime = steadyTimeRef();
+    i->priority = isBackgroundTask(i->taskType) ? TaskPriorityBackground : taskPriorityContext;
+
+    dst.queue[i->priority].push_back(i);
+    if (!dst.ready[i->priority])
+    {
+        dst.ready[i->priority] = true;
+        taskReady[i->priority].push_back(dstKey);
+    }
+
+    if (replaceable)
+    {
+        taskDedupe.insert(dedupeKey, i);
+    }
+
+    perfCounters().tasksAdded++;
+    taskTimer->start(0); // send when the current request is processed
+    return true;
+}
+
+/*! Removes a task from the storage and the dedupe index.
+    The caller removes it from its destination queue.
+ */
+void DeRestPluginPrivate::dequeueTask(std::list<TaskItem>::iterator i)
+{
+    const TaskDedupeKey dedupeKey(taskDstKey(i->req), i->req.dstEndpoint(), i->req.clusterId(), i->taskType);
+    QHash<TaskDedupeKey, std::list<TaskItem>::iterator>::iterator h = taskDedupe.find(dedupeKey);
+    if (h != taskDedupe.end() && h.value() == i)
+    {
+        taskDedupe.erase(h);
+    }
+
+    tasks.erase(i);
+}
+
+/*! Removes a confirmed or timed out request from the running tasks and
+    feeds the result into the windows of its destination, route and the network.
+    \param id - the APS request id of the running task
+    \param conf - the APSDE-DATA.confirm or 0 if timed out
+ */
+void DeRestPluginPrivate::finishRunningTask(quint8 id, const deCONZ::ApsDataConfirm *conf)
+{
+    ApsRequestSlot &slot = apsRequests[id];
+    if (!DBG_Assert(slot.owner == ApsOwnerTask))
+    {
+        return;
+    }
+
+    const TaskItem *i = &slot.task;
+    const bool success = conf && conf->status() == deCONZ::ApsSuccessStatus;
+    const int rtt = i->sendTime.msecsTo(steadyTimeRef());
+
+    TaskWindow *windows[3] = { &taskWindowGlobal, 0, 0 };
+
+    QHash<TaskDstKey, TaskDestinationQueue>::iterator d = taskDestinations.find(taskDstKey(i->req));
+    if (d != taskDestinations.end())
+    {
+        windows[1] = &d->window;
+    }
+
+    if (i->routeAddr != 0)
+    {
+        QHash<quint64, TaskWindow>::iterator r = taskRouteWindows.find(i->routeAddr);
+        if (r != taskRouteWindows.end())
+        {
+            windows[2] = &r.value();
+        }
+    }
+
+    for (int w = 0; w < 3; w++)
+    {
+        if (!windows[w])
+        {
+            continue;
+        }
+
+        if (success)
+        {
+            windows[w]->confirmed(rtt);
+        }
+        else
+        {
+            windows[w]->failed(conf == 0);
+        }
+    }
+
+    PerfCounters &perf = perfCounters();
+    if (!conf)
+    {
+        perf.tasksTimedOut++;
+    }
+    else
+    {
+        perf.apsConfirmLatency.record(rtt);
+        if (success)
+        {
+            perf.tasksConfirmed++;
+        }
+        else
+        {
+            perf.tasksFailed++;
+        }
+    }
+
+    slot.owner = ApsOwnerNone;
+    slot.task = TaskItem(); // release the request payload
+    runningTaskCount--;
+
+    pruneTaskDestination(d);
+}
+
+/*! Rebuilds the map of end devices to their parent routers from the neighbor tables.
+
+    Requests to sleeping end devices are buffered by the parent, all children of a
+    parent therefore share one route window.
+ */
+void DeRestPluginPrivate::updateTaskRoutes()
+{
+    taskRouteParents.clear();
+
+    if (!apsCtrl)
+    {
+        return;
+    }
+
+    int i = 0;
+    const deCONZ::Node *node;
+    QSet<quint64> endDevices;
+
+    while (apsCtrl->getNode(i, &node) == 0)
+    {
+        if (node->isEndDevice())
+        {
+            endDevices.insert(node->address().ext());
+        }
+        i++;
+    }
+
+    i = 0;
+    while (!endDevices.isEmpty() && apsCtrl->getNode(i, &node) == 0)
+    {
+        if (!node->isEndDevice())
+        {
+            const std::vector<deCONZ::NodeNeighbor> &neighbors = node->neighbors();
+            std::vector<deCONZ::NodeNeighbor>::const_iterator nb = neighbors.begin();
+            std::vector<deCONZ::NodeNeighbor>::const_iterator nbEnd = neighbors.end();
+
+            for (; nb != nbEnd; ++nb)
+            {
+                if (endDevices.contains(nb->address().ext()))
+                {
+                    taskRouteParents.insert(nb->address().ext(), node->address().ext());
+                }
+            }
+        }
+        i++;
+    }
+
+    // forget idle windows of routers which aren't parents anymore
+    QSet<quint64> parents = taskRouteParents.values().toSet();
+    QHash<quint64, TaskWindow>::iterator r = taskRouteWindows.begin();
+    while (r != taskRouteWindows.end())
+    {
+        if (r->onAir == 0 && !parents.contains(r.key()))
+        {
+            r = taskRouteWindows.erase(r);
+        }
+        else
+        {
+            ++r;
+        }
+    }
+}
+
+/*! Drops all queued and running tasks.
+ */
+void DeRestPluginPrivate::clearTasks()
+{
+    for (size_t id = 0; id < apsRequests.size(); id++)
+    {
+        if (apsRequests[id].owner == ApsOwnerTask)
+        {
+            apsRequests[id].owner = ApsOwnerNone;
+            apsRequests[id].task = TaskItem();
+        }
+    }
+    runningTaskCount = 0;
+    tasks.clear();
+    taskDestinations.clear();
+    taskDedupe.clear();
+    taskRouteWindows.clear();
+    taskWindowGlobal.onAir = 0;
+    for (int p = 0; p < TaskPriorityMax; p++)
+    {
+        taskReady[p].clear();
+    }
+}
+
+/*! Fires the APS-DATA.request of a queued task.
+    \param i - the task
+    \param dst - the queue of the task destination
+    \param now - current time used for group and broadcast pacing
+    \return TaskSent, TaskDeferred (keep queued) or TaskDropped
+ */
+int DeRestPluginPrivate::sendTask(std::list<TaskItem>::iterator i, TaskDestinationQueue &dst, const SteadyTimeRef &now)
+{
+    // drop dead unicasts
+    if (i->lightNode && !i->lightNode->isAvailable())
+    {
+        DBG_Printf(DBG_INFO, "drop request to zombie\n");
+        return TaskDropped;
+    }
+
+    const bool pushRunning = (i->req.state() != deCONZ::FireAndForgetState);
+    const bool isGroupcast = (i->req.dstAddressMode() == deCONZ::ApsGroupAddress);
+    const bool isBroadcast = (i->req.dstAddressMode() == deCONZ::ApsNwkAddress && i->req.dstAddress().nwk() >= 0xFFF8);
+    TokenBucket *groupBucket = 0;
+
+    if (isGroupcast)
+    {
+        const quint16 groupId = i->req.dstAddress().group();
+
+        if (!getGroupForId(groupId))
+        {
+            DBG_Printf(DBG_INFO, "drop request to unknown group 0x%04X\n", groupId);
+            return TaskDropped;
+        }
+
+        QHash<quint16, TokenBucket>::iterator b = groupSendBuckets.find(groupId);
+        if (b == groupSendBuckets.end())
+        {
+            b = groupSendBuckets.insert(groupId, TokenBucket(GROUP_SEND_BURST, gwGroupSendDelay));
+        }
+        groupBucket = &b.value();
+        groupBucket->interval = gwGroupSendDelay; // might be changed through the REST API
+
+        if (!groupBucket->isAvailable(now))
+        {
+            DBG_Printf(DBG_INFO_L2, "delayed group sending\n");
+            return TaskDeferred;
+        }
+    }
+
+    if (isGroupcast || isBroadcast)
+    {
+        if (!broadcastBudget.isAvailable(now))
+        {
+            // user commands are kept until they can be sent, only stale queries and
+            // state updates which will be superseded anyway are given up
+            const bool mayDrop = (i->priority == TaskPriorityBackground) || isReplaceableTask(i->taskType);
+
+            if (mayDrop && i->queueTime.msecsTo(now) > BROADCAST_MAX_WAIT)
+            {
+                DBG_Printf(DBG_INFO, "drop broadcast cluster 0x%04X, broadcast budget exhausted\n", i->req.clusterId());
+                broadcastsDropped++;
+                return TaskDropped;
+            }
+
+            DBG_Printf(DBG_INFO_L2, "delayed broadcast, broadcast budget exhausted\n");
+            broadcastsDeferred++;
+            return TaskDeferred;
+        }
+    }
+
+    // groupcast tasks
+    if (isGroupcast)
+    {
+        i->sendTime = steadyTimeRef();
+        if (apsCtrl->apsdeDataRequest(i->req) != deCONZ::Success)
+        {
+            return TaskDeferred;
+        }
+
+        groupBucket->take();
+        broadcastBudget.take();
+        broadcastsSent++;
+    }
+    // unicast/broadcast tasks
+    else
+    {
+        i->sendTime = steadyTimeRef();
+        int ret = apsCtrl->apsdeDataRequest(i->req);
+
+        if (ret == deCONZ::ErrorNodeIsZombie)
+        {
+            DBG_Printf(DBG_INFO, "drop request to zombie\n");
+            return TaskDropped;
+        }
+        else if (ret != deCONZ::Success)
+        {
+            DBG_Printf(DBG_INFO, "enqueue APS request failed with error %d\n", ret);
+            return TaskDeferred;
+        }
+
+        if (isBroadcast)
+        {
+            broadcastBudget.take();
+            broadcastsSent++;
+        }
+    }
+
+    if (pushRunning)
+    {
+        ApsRequestSlot &slot = registerApsRequest(i->req, ApsOwnerTask);
+        slot.task = *i;
+        runningTaskCount++;
+        perfCounters().tasksSent++;
+        perfCounters().tasksRunningMax = qMax(perfCounters().tasksRunningMax, runningTaskCount);
+        dst.window.sent();
+        taskWindowGlobal.sent();
+
+        if (i->routeAddr != 0)
+        {
+            taskRouteWindows[i->routeAddr].sent();
+        }
+    }
+
+    return TaskSent;
+}
+
+/*! Fires queued APS-DATA.requests.
+
+    Destinations are served round robin, higher priorities first. A busy destination
+    doesn't block the others. Called after tasks are added and when requests are confirmed,
+    the task timer is only restarted while tasks are deferred.
+ */
+void DeRestPluginPrivate::processTasks()
+{
+    if (!apsCtrl)
+    {
+        return;
+    }
+
+    if (!isInNetwork())
+    {
+        if (!tasks.empty() || runningTaskCount > 0)
+        {
+            DBG_Printf(DBG_INFO, "Not in network cleanup %d tasks\n", (runningTaskCount + (int)tasks.size()));
+            clearTasks();
+        }
+        return;
+    }
+
+    const SteadyTimeRef now = steadyTimeRef();
+
+    // drop requests which weren't confirmed within the timeout of their destination
+    for (size_t id = 0; runningTaskCount > 0 && id < apsRequests.size(); id++)
+    {
+        const ApsRequestSlot &slot = apsRequests[id];
+        if (slot.owner != ApsOwnerTask)
+        {
+            continue;
+        }
+
+        QHash<TaskDstKey, TaskDestinationQueue>::const_iterator d = taskDestinations.constFind(taskDstKey(slot.task.req));
+        const int timeout = (d != taskDestinations.constEnd()) ? d->window.timeout() : TASK_TIMEOUT_MAX;
+        const int dt = slot.sendTime.msecsTo(now);
+        if (dt > timeout)
+        {
+            DBG_Printf(DBG_INFO, "drop request %u cluster 0x%04X, not confirmed after %d ms\n", (unsigned)id, slot.task.req.clusterId(), dt);
+            finishRunningTask(id, 0);
+        }
+    }
+
+    if (tasks.empty())
+    {
+        if (runningTaskCount > 0 && !taskTimer->isActive())
+        {
+            taskTimer->start(TASK_SWEEP_INTERVAL);
+        }
+        return;
+    }
+
+    static bool processing = false; // apsdeDataRequest() might call back into here
+    if (processing)
+    {
+        return;
+    }
+    processing = true;
+
+    bool deferred = false;
+
+    for (int p = 0; p < TaskPriorityMax; p++)
+    {
+        std::deque<TaskDstKey> &ready = taskReady[p];
+
+        for (size_t n = ready.size(); n > 0 && !ready.empty(); n--) // visit each destination once
+        {
+            if (!taskWindowGlobal.isOpen())
+            {
+                DBG_Printf(DBG_INFO_L2, "%d running tasks, wait\n", runningTaskCount);
+                deferred = true;
+                break;
+            }
+
+            const TaskDstKey key = ready.front();
+            ready.pop_front();
+
+            QHash<TaskDstKey, TaskDestinationQueue>::iterator d = taskDestinations.find(key);
+            if (d == taskDestinations.end())
+            {
+                continue;
+            }
+
+            TaskDestinationQueue &dst = d.value();
+            std::deque<std::list<TaskItem>::iterator> &queue = dst.queue[p];
+
+            if (!queue.empty())
+            {
+                std::list<TaskItem>::iterator i = queue.front();
+
+                i->routeAddr = 0;
+                if (key.mode == deCONZ::ApsExtAddress)
+                {
+                    i->routeAddr = taskRouteParents.value(key.addr, 0);
+                }
+
+                TaskWindow *route = 0;
+                if (i->routeAddr != 0)
+                {
+                    QHash<quint64, TaskWindow>::iterator r = taskRouteWindows.find(i->routeAddr);
+                    if (r == taskRouteWindows.end())
+                    {
+                        r = taskRouteWindows.insert(i->routeAddr, TaskWindow(TASK_WINDOW_INITIAL, TASK_WINDOW_MAX_ROUTE));
+                    }
+                    route = &r.value();
+                }
+
+                // send only as many requests to a destination and its parent as the windows allow
+                if (!dst.window.isOpen() || (route && !route->isOpen()))
+                {
+                    DBG_Printf(DBG_INFO_L2, "delay sending request %u cluster 0x%04X, onAir %d\n", i->req.id(), i->req.clusterId(), dst.window.onAir);
+                    ready.push_back(key);
+                    deferred = true;
+                    continue;
+                }
+
+                int ret = sendTask(i, dst, now);
+
+                if (ret == TaskDeferred)
+                {
+                    deferred = true;
+                }
+                else
+                {
+                    if (ret == TaskDropped)
+                    {
+                        perfCounters().tasksDropped++;
+                    }
+                    queue.pop_front();
+                    dequeueTask(i);
+                }
+            }
+
+            if (queue.empty())
+            {
+                dst.ready[p] = false;
+                pruneTaskDestination(d);
+            }
+            else
+            {
+                ready.push_back(key);
+            }
+        }
+    }
+
+    processing = false;
+
+    if (deferred)
+    {
+        taskTimer->start(TASK_RETRY_INTERVAL);
+    }
+    else if (runningTaskCount > 0 && !taskTimer->isActive())
+    {
+        taskTimer->start(TASK_SWEEP_INTERVAL);
+    }
+}
+
+/*! Returns the number of tasks for a specific address.
+    \param address - the destination address
+ */
+int DeRestPluginPrivate::taskCountForAddress(const deCONZ::Address &address)
+{
+    TaskDstKey key;
+    deCONZ::Address addr = address;
+    resolveTaskDstAddress(addr);
+
+    if (addr.hasExt())
+    {
+        key = TaskDstKey(deCONZ::ApsExtAddress, addr.ext());
+    }
+    else if (addr.hasNwk())
+    {
+        key = TaskDstKey(deCONZ::ApsNwkAddress, addr.nwk());
+    }
+    else
+    {
+        key = TaskDstKey(deCONZ::ApsGroupAddress, address.group());
+    }
+
+    QHash<TaskDstKey, TaskDestinationQueue>::const_iterator d = taskDestinations.constFind(key);
+    if (d != taskDestinations.constEnd())
+    {
+        return d->queued() + d->window.onAir;
+    }
+
+    return 0;
+}
@@ -1,15 +1,72 @@
+#include "websocket_server.h"
+
+/*! Returns the name of a slow client policy as used in the REST API.
+ */
+QString WebSocketServer::policyToString(SlowClientPolicy policy)
+{
+    switch (policy)
+    {
+    case PolicyDropOldest: return QLatin1String("dropoldest");
+    case PolicyDisconnect: return QLatin1String("disconnect");
+    default:
+        break;
+    }
+
+    return QLatin1String("coalesce");
+}
+
+/*! Parses the name of a slow client policy.
+    \return true if \p str is a valid policy name
+ */
+bool WebSocketServer::policyFromString(const QString &str, SlowClientPolicy *policy)
+{
+    if (str == QLatin1String("coalesce"))
+    {
+        *policy = PolicyCoalesce;
+    }
+    else if (str == QLatin1String("dropoldest"))
+    {
+        *policy = PolicyDropOldest;
+    }
+    else if (str == QLatin1String("disconnect"))
+    {
+        *policy = PolicyDisconnect;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
 #ifdef USE_WEBSOCKETS
 #include <QWebSocket>
 #include <QWebSocketServer>
 
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QUrlQuery>
 #include "deconz/dbg_trace.h"
-#include "websocket_server.h"
+#include "json.h"
+#include "perf_counters.h"
 
 /*! Constructor.
  */
 WebSocketServer::WebSocketServer(QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_broadcastSeq(0),
+    m_policy(PolicyCoalesce)
 {
+    // numbers of earlier runs fall outside [m_baseSeq, m_seq], so that their clients get a resync
+    m_seq = randomCounterEpoch();
+    m_baseSeq = m_seq;
+
+    m_batchTimer = new QTimer(this);
+    m_batchTimer->setSingleShot(true);
+    connect(m_batchTimer, SIGNAL(timeout()), this, SLOT(batchTimerFired()));
+
     srv = new QWebSocketServer("deconz", QWebSocketServer::NonSecureMode, this);
 
     quint16 p = 0;
@@ -49,7 +106,537 @@ void WebSocketServer::onNewConnection()
     while (srv->hasPendingConnections())
     {
         QWebSocket *sock = srv->nextPendingConnection();
-        clients.push_back(sock);
+        connect(sock, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
+        connect(sock, SIGNAL(textMessageReceived(QString)), this, SLOT(onTextMessageReceived(QString)));
+        // queued, the socket may disconnect while a broadcast iterates the clients
+        connect(sock, SIGNAL(disconnected()), this, SLOT(onDisconnected()), Qt::QueuedConnection);
+
+        WebSocketClient &client = m_clients[sock];
+        client.sock = sock;
+        client.peer = QString("%1:%2").arg(sock->peerAddress().toString()).arg(sock->peerPort());
+        subscribe(client, QStringList(QLatin1String("#"))); // all messages
+
+        const QUrlQuery query(sock->requestUrl());
+        if (query.hasQueryItem(QLatin1String("since")))
+        {
+            bool ok;
+            const quint64 since = query.queryItemValue(QLatin1String("since")).toULongLong(&ok);
+            if (ok)
+            {
+                replay(client, since);
+            }
+        }
+    }
+
+    removeDeadClients();
+}
+
+/*! Hands more queued messages to a socket after data was written.
+ */
+void WebSocketServer::onBytesWritten(qint64 bytes)
+{
+    QHash<QWebSocket*, WebSocketClient>::iterator c = m_clients.find(qobject_cast<QWebSocket*>(sender()));
+
+    if (c != m_clients.end())
+    {
+        c->pendingBytes = qMax(Q_INT64_C(0), c->pendingBytes - bytes); // bytes include frame headers
+        flush(*c);
+    }
+}
+
+/*! Removes a client when its connection is closed.
+    Without this a client which doesn't receive messages would never be removed.
+ */
+void WebSocketServer::onDisconnected()
+{
+    QWebSocket *sock = qobject_cast<QWebSocket*>(sender());
+
+    if (sock && m_clients.contains(sock))
+    {
+        DBG_Printf(DBG_INFO, "Websocket %s disconnected\n", qPrintable(m_clients[sock].peer));
+        m_dropClients.append(sock);
+        removeDeadClients();
+    }
+}
+
+/*! Handles a subscribe message of a client.
+ */
+void WebSocketServer::onTextMessageReceived(const QString &msg)
+{
+    QHash<QWebSocket*, WebSocketClient>::iterator c = m_clients.find(qobject_cast<QWebSocket*>(sender()));
+
+    if (c == m_clients.end())
+    {
+        return;
+    }
+
+    bool ok;
+    const QVariantMap map = Json::parse(msg, ok).toMap();
+
+    if (!ok || map["t"].toString() != QLatin1String("subscribe"))
+    {
+        DBG_Printf(DBG_INFO, "Websocket %s ignore message %s\n", qPrintable(c->peer), qPrintable(msg.left(64)));
+        return;
+    }
+
+    QStringList keys;
+    QVariantList state = map["state"].toList();
+    for (int i = 0; i < state.size(); i++)
+    {
+        keys.append(state[i].toString());
+    }
+
+    if (keys.isEmpty())
+    {
+        keys.append(QLatin1String("*"));
+    }
+
+    QStringList topics;
+    const QVariantMap resources = map["resources"].toMap();
+    QVariantMap::const_iterator r = resources.constBegin();
+    QVariantMap::const_iterator rend = resources.constEnd();
+
+    for (; r != rend; ++r)
+    {
+        QStringList ids;
+        const QVariantList list = r.value().toList();
+        for (int i = 0; i < list.size(); i++)
+        {
+            ids.append(list[i].toString());
+        }
+
+        if (ids.isEmpty())
+        {
+            ids.append(QLatin1String("*")); // "*" or empty list
+        }
+
+        for (int i = 0; i < ids.size(); i++)
+        {
+            const QString topic = r.key() + QLatin1Char('/') + ids[i];
+            topics.append(topic);
+
+            for (int k = 0; k < keys.size(); k++)
+            {
+                topics.append(topic + QLatin1Char('/') + keys[k]);
+            }
+        }
+    }
+
+    if (topics.size() > WS_CLIENT_TOPICS_MAX)
+    {
+        DBG_Printf(DBG_INFO, "Websocket %s too many topics %d, subscribe to all\n", qPrintable(c->peer), topics.size());
+        topics.clear();
+    }
+
+    if (topics.isEmpty())
+    {
+        topics.append(QLatin1String("#"));
+    }
+
+    int batchWindow = map["batch"].toInt(&ok);
+    if (!ok || batchWindow < 0)
+    {
+        batchWindow = 0;
+    }
+
+    if (c->batchWindow > 0 && batchWindow == 0)
+    {
+        sendBatch(*c);
+    }
+    c->batchWindow = qMin(batchWindow, WS_BATCH_WINDOW_MAX);
+
+    DBG_Printf(DBG_INFO, "Websocket %s subscribed to %d topics, batch window %d ms\n", qPrintable(c->peer), topics.size(), c->batchWindow);
+    subscribe(*c, topics);
+
+    if (map.contains(QLatin1String("since")))
+    {
+        const quint64 since = map["since"].toULongLong(&ok);
+        if (ok)
+        {
+            replay(*c, since);
+            removeDeadClients();
+        }
+    }
+}
+
+/*! Replaces the topics of a client in the inverted index.
+ */
+void WebSocketServer::subscribe(WebSocketClient &client, const QStringList &topics)
+{
+    for (int i = 0; i < client.topics.size(); i++)
+    {
+        QHash<QString, QVector<QWebSocket*> >::iterator t = m_topics.find(client.topics[i]);
+        if (t == m_topics.end())
+        {
+            continue;
+        }
+
+        const int pos = t->indexOf(client.sock);
+        if (pos != -1)
+        {
+            (*t)[pos] = t->back();
+            t->pop_back();
+        }
+
+        if (t->isEmpty())
+        {
+            m_topics.erase(t);
+        }
+    }
+
+    client.topics = topics;
+    client.topics.removeDuplicates();
+
+    for (int i = 0; i < client.topics.size(); i++)
+    {
+        m_topics[client.topics[i]].append(client.sock);
+    }
+}
+
+/*! Stamps a message with the next sequence number and keeps it in the event log.
+    \param msg the message as JSON object
+    \param topics the topics of the message
+    \return the stamped message
+ */
+QString WebSocketServer::logMessage(const QString &msg, const QStringList &topics)
+{
+    m_seq++;
+
+    WebSocketEvent e;
+    e.seq = m_seq;
+    e.topics = topics;
+
+    if (msg.startsWith(QLatin1Char('{')) && msg.size() > 2)
+    {
+        e.text.reserve(msg.size() + 32);
+        e.text += QLatin1String("{\"seq\":");
+        e.text += QString::number(m_seq);
+        e.text += QLatin1Char(',');
+        e.text += msg.midRef(1);
+    }
+    else
+    {
+        e.text = msg;
+    }
+
+    if (m_log.size() >= WS_EVENT_LOG_SIZE)
+    {
+        m_log.pop_front();
+    }
+
+    m_log.push_back(e);
+    return e.text;
+}
+
+/*! Sends the logged messages after sequence number \p since which match the topics of a client.
+    A resync message is sent instead if \p since wasn't issued by this run
+    or the log doesn't reach back to it.
+ */
+void WebSocketServer::replay(WebSocketClient &client, quint64 since)
+{
+    const bool foreign = since < m_baseSeq || since > m_seq;
+
+    if (!foreign && since == m_seq)
+    {
+        return; // up to date
+    }
+
+    if (foreign || m_log.empty() || since + 1 < m_log.front().seq)
+    {
+        DBG_Printf(DBG_INFO, "Websocket %s can't resume from %llu, resync\n", qPrintable(client.peer), (unsigned long long)since);
+        m_broadcastSeq++;
+        sendToClient(client, QString("{\"t\":\"resync\",\"seq\":%1}").arg(m_seq), QString());
+        return;
+    }
+
+    const QSet<QString> topics = QSet<QString>::fromList(client.topics);
+    size_t count = 0;
+
+    for (size_t i = since + 1 - m_log.front().seq; i < m_log.size(); i++)
+    {
+        const WebSocketEvent &e = m_log[i];
+
+        for (int t = 0; t < e.topics.size(); t++)
+        {
+            if (topics.contains(e.topics[t]))
+            {
+                m_broadcastSeq++;
+                sendToClient(client, e.text, QString());
+                count++;
+                break;
+            }
+        }
+    }
+
+    DBG_Printf(DBG_INFO, "Websocket %s resumed from %llu, %u messages\n", qPrintable(client.peer), (unsigned long long)since, (uint)count);
+}
+
+/*! Sends a message to a client unless it already got it from another topic of the same broadcast.
+    \param coalesceKey - key under which a queued message may be replaced, or empty
+ */
+void WebSocketServer::sendToClient(WebSocketClient &client, const QString &msg, const QString &coalesceKey)
+{
+    if (client.broadcastSeq == m_broadcastSeq)
+    {
+        return;
+    }
+
+    client.broadcastSeq = m_broadcastSeq;
+
+    if (client.sock->state() != QAbstractSocket::ConnectedState)
+    {
+        DBG_Printf(DBG_INFO, "Remove websocket %s\n", qPrintable(client.peer));
+        m_dropClients.append(client.sock);
+    }
+    else if (client.batchWindow > 0)
+    {
+        addToBatch(client, msg, coalesceKey);
+    }
+    else if (!enqueue(client, msg, coalesceKey))
+    {
+        disconnectSlowClient(client);
+    }
+}
+
+/*! Closes the connection of a client whose queue is full, the client is removed after the broadcast.
+ */
+void WebSocketServer::disconnectSlowClient(WebSocketClient &client)
+{
+    DBG_Printf(DBG_INFO, "Websocket %s too slow, %u messages queued, disconnect\n", qPrintable(client.peer), (uint)client.queue.size());
+    perfCounters().websocketDisconnected++;
+    client.sock->close(QWebSocketProtocol::CloseCodePolicyViolated, QLatin1String("too slow"));
+    m_dropClients.append(client.sock);
+}
+
+/*! Collects a message for the next batch frame of a client.
+    A pending message with the same coalesce key is replaced and keeps its position.
+ */
+void WebSocketServer::addToBatch(WebSocketClient &client, const QString &msg, const QString &coalesceKey)
+{
+    if (!coalesceKey.isEmpty())
+    {
+        std::vector<WebSocketMessage>::iterator i = client.batch.begin();
+        std::vector<WebSocketMessage>::iterator end = client.batch.end();
+
+        for (; i != end; ++i)
+        {
+            if (i->key == coalesceKey)
+            {
+                i->text = msg;
+                return;
+            }
+        }
+    }
+
+    if (client.batch.empty())
+    {
+        client.batchDue = steadyTimeRef().addMSecs(client.batchWindow);
+
+        if (!m_batchClients.contains(client.sock))
+        {
+            m_batchClients.append(client.sock);
+        }
+
+        if (!m_batchTimer->isActive() || m_batchTimer->remainingTime() > client.batchWindow)
+        {
+            m_batchTimer->start(client.batchWindow);
+        }
+    }
+
+    WebSocketMessage m;
+    m.text = msg;
+    m.key = coalesceKey;
+    client.batch.push_back(m);
+
+    if (client.batch.size() >= WS_BATCH_MAX_MESSAGES)
+    {
+        sendBatch(client);
+    }
+}
+
+/*! Sends the collected messages of a client as one JSON array frame.
+ */
+void WebSocketServer::sendBatch(WebSocketClient &client)
+{
+    if (client.batch.empty())
+    {
+        return;
+    }
+
+    int size = 2;
+    for (size_t i = 0; i < client.batch.size(); i++)
+    {
+        size += client.batch[i].text.size() + 1;
+    }
+
+    QString frame;
+    frame.reserve(size);
+    frame += QLatin1Char('[');
+
+    for (size_t i = 0; i < client.batch.size(); i++)
+    {
+        if (i > 0)
+        {
+            frame += QLatin1Char(',');
+        }
+        frame += client.batch[i].text;
+    }
+
+    frame += QLatin1Char(']');
+    client.batch.clear();
+
+    if (!enqueue(client, frame, QString()))
+    {
+        disconnectSlowClient(client);
+    }
+}
+
+/*! Sends the batch frames which are due and waits for the next one.
+ */
+void WebSocketServer::batchTimerFired()
+{
+    const SteadyTimeRef now = steadyTimeRef();
+    qint64 wait = -1;
+    int i = 0;
+
+    while (i < m_batchClients.size())
+    {
+        QHash<QWebSocket*, WebSocketClient>::iterator c = m_clients.find(m_batchClients[i]);
+
+        if (c != m_clients.end() && !c->batch.empty() && now < c->batchDue)
+        {
+            const qint64 ms = now.msecsTo(c->batchDue);
+            wait = (wait < 0) ? ms : qMin(wait, ms);
+            i++;
+            continue;
+        }
+
+        if (c != m_clients.end())
+        {
+            sendBatch(*c);
+        }
+
+        m_batchClients[i] = m_batchClients.back();
+        m_batchClients.pop_back();
+    }
+
+    removeDeadClients();
+
+    if (wait >= 0)
+    {
+        m_batchTimer->start(int(wait));
+    }
+}
+
+/*! Sends a message to all clients which subscribed \p topic.
+ */
+void WebSocketServer::sendToTopic(const QString &topic, const QString &msg, const QString &coalesceKey)
+{
+    QHash<QString, QVector<QWebSocket*> >::const_iterator t = m_topics.constFind(topic);
+
+    if (t == m_topics.constEnd())
+    {
+        return;
+    }
+
+    for (int i = 0; i < t->size(); i++)
+    {
+        QHash<QWebSocket*, WebSocketClient>::iterator c = m_clients.find(t->at(i));
+        if (c != m_clients.end())
+        {
+            sendToClient(*c, msg, coalesceKey);
+        }
+    }
+}
+
+/*! Removes clients which were found disconnected or too slow during a broadcast.
+ */
+void WebSocketServer::removeDeadClients()
+{
+    for (int i = 0; i < m_dropClients.size(); i++)
+    {
+        QHash<QWebSocket*, WebSocketClient>::iterator c = m_clients.find(m_dropClients[i]);
+        if (c != m_clients.end())
+        {
+            subscribe(*c, QStringList());
+            m_batchClients.removeAll(c->sock);
+            c->sock->deleteLater();
+            m_clients.erase(c);
+        }
+    }
+
+    m_dropClients.clear();
+}
+
+/*! Puts a message into the queue of a client and applies the slow client policy if the queue is full.
+    \return false if the client shall be disconnected
+ */
+bool WebSocketServer::enqueue(WebSocketClient &client, const QString &msg, const QString &key)
+{
+    const qint64 size = msg.size();
+
+    if (client.queue.empty() && client.pendingBytes < WS_CLIENT_PENDING_MAX_BYTES)
+    {
+        client.sock->sendTextMessage(msg); // fast path, no backlog
+        client.pendingBytes += size;
+        return true;
+    }
+
+    const bool full = client.queue.size() >= WS_CLIENT_QUEUE_MAX_MESSAGES ||
+                      client.queuedBytes + size > WS_CLIENT_QUEUE_MAX_BYTES;
+
+    if (full && m_policy == PolicyDisconnect)
+    {
+        return false;
+    }
+
+    if (full && m_policy == PolicyCoalesce && !key.isEmpty())
+    {
+        std::deque<WebSocketMessage>::iterator i = client.queue.begin();
+        std::deque<WebSocketMessage>::iterator end = client.queue.end();
+
+        for (; i != end; ++i)
+        {
+            if (i->key == key)
+            {
+                client.queuedBytes += size - i->text.size();
+                i->text = msg; // keeps its position
+                client.coalesced++;
+                perfCounters().websocketCoalesced++;
+                return true;
+            }
+        }
+    }
+
+    while (!client.queue.empty() &&
+           (client.queue.size() >= WS_CLIENT_QUEUE_MAX_MESSAGES ||
+            client.queuedBytes + size > WS_CLIENT_QUEUE_MAX_BYTES))
+    {
+        client.queuedBytes -= client.queue.front().text.size();
+        client.queue.pop_front();
+        client.dropped++;
+        perfCounters().websocketDropped++;
+    }
+
+    WebSocketMessage m;
+    m.text = msg;
+    m.key = key;
+    client.queue.push_back(m);
+    client.queuedBytes += size;
+    return true;
+}
+
+/*! Hands queued messages to the socket until WS_CLIENT_PENDING_MAX_BYTES are unwritten.
+ */
+void WebSocketServer::flush(WebSocketClient &client)
+{
+    while (!client.queue.empty() && client.pendingBytes < WS_CLIENT_PENDING_MAX_BYTES)
+    {
+        const WebSocketMessage &m = client.queue.front();
+        client.sock->sendTextMessage(m.text);
+        client.pendingBytes += m.text.size();
+        client.queuedBytes -= m.text.size();
+        client.queue.pop_front();
     }
 }
 
@@ -58,28 +645,110 @@ void WebSocketServer::onNewConnection()
  */
 void WebSocketServer::broadcastTextMessage(const QString &msg)
 {
-    for (size_t i = 0; i < clients.size(); i++)
+    QElapsedTimer perfTimer;
+    perfTimer.start();
+
+    m_broadcastSeq++;
+    const QString text = logMessage(msg, QStringList(QLatin1String("#")));
+
+    QHash<QWebSocket*, WebSocketClient>::iterator i = m_clients.begin();
+    QHash<QWebSocket*, WebSocketClient>::iterator end = m_clients.end();
+
+    for (; i != end; ++i)
     {
-        QWebSocket *sock = clients[i];
+        sendToClient(*i, text, QString());
+    }
 
-        if (sock->state() == QAbstractSocket::ConnectedState)
-        {
-            sock->sendTextMessage(msg);
-        }
-        else
+    removeDeadClients();
+
+    PerfCounters &perf = perfCounters();
+    perf.websocketMessages++;
+    perf.websocketBroadcastTime.record(perfTimer.nsecsElapsed() / 1000);
+}
+
+/*! Sends a message about a resource to the clients which subscribed it.
+    \param msg the message as JSON string
+    \param resource the resource type like "lights"
+    \param id the resource id
+    \param key the changed state key, or empty for added, deleted and other resource events
+    \param coalesce true if a queued message of the same state key may be replaced when a client is too slow
+    \param rooms the ids of the groups in which a light is member, for the rooms/<id>/<key> topics
+ */
+void WebSocketServer::broadcastTextMessage(const QString &msg, const QString &resource, const QString &id,
+                                           const QString &key, bool coalesce, const QStringList &rooms)
+{
+    QElapsedTimer perfTimer;
+    perfTimer.start();
+
+    m_broadcastSeq++;
+
+    const QString any = QLatin1String("*");
+    const QString topic = resource + QLatin1Char('/') + id;
+    const QString anyTopic = resource + QLatin1Char('/') + any;
+    const QString coalesceKey = (coalesce && !key.isEmpty()) ? (topic + QLatin1Char('/') + key) : QString();
+
+    QStringList topics;
+    topics.append(QLatin1String("#"));
+
+    if (key.isEmpty())
+    {
+        topics.append(topic);
+        topics.append(anyTopic);
+    }
+    else
+    {
+        topics.append(topic + QLatin1Char('/') + key);
+        topics.append(topic + QLatin1Char('/') + any);
+        topics.append(anyTopic + QLatin1Char('/') + key);
+        topics.append(anyTopic + QLatin1Char('/') + any);
+
+        for (int i = 0; i < rooms.size(); i++)
         {
-            DBG_Printf(DBG_INFO, "Remove websocket %s:%u\n", qPrintable(sock->peerAddress().toString()), sock->peerPort());
-            sock->deleteLater();
-            clients[i] = clients.back();
-            clients.pop_back();
+            const QString room = QLatin1String("rooms/") + rooms[i];
+            topics.append(room + QLatin1Char('/') + key);
+            topics.append(room + QLatin1Char('/') + any);
         }
     }
+
+    const QString text = logMessage(msg, topics);
+
+    for (int i = 0; i < topics.size(); i++)
+    {
+        sendToTopic(topics[i], text, coalesceKey);
+    }
+
+    removeDeadClients();
+
+    PerfCounters &perf = perfCounters();
+    perf.websocketMessages++;
+    perf.websocketBroadcastTime.record(perfTimer.nsecsElapsed() / 1000);
 }
 #else // no websockets
   WebSocketServer::WebSocketServer(QObject *parent) :
-      QObject(parent)
+      QObject(parent),
+      m_batchTimer(0),
+      m_seq(0),
+      m_baseSeq(0),
+      m_broadcastSeq(0),
+      m_policy(PolicyCoalesce)
   { }
   void WebSocketServer::onNewConnection() { }
+  void WebSocketServer::onBytesWritten(qint64) { }
+  void WebSocketServer::onDisconnected() { }
+  void WebSocketServer::onTextMessageReceived(const QString &) { }
+  void WebSocketServer::subscribe(WebSocketClient &, const QStringList &) { }
+  QString WebSocketServer::logMessage(const QString &msg, const QStringList &) { return msg; }
+  void WebSocketServer::replay(WebSocketClient &, quint64) { }
+  void WebSocketServer::sendToClient(WebSocketClient &, const QString &, const QString &) { }
+  void WebSocketServer::sendToTopic(const QString &, const QString &, const QString &) { }
+  void WebSocketServer::removeDeadClients() { }
+  void WebSocketServer::disconnectSlowClient(WebSocketClient &) { }
+  void WebSocketServer::addToBatch(WebSocketClient &, const QString &, const QString &) { }
+  void WebSocketServer::sendBatch(WebSocketClient &) { }
+  void WebSocketServer::batchTimerFired() { }
+  bool WebSocketServer::enqueue(WebSocketClient &, const QString &, const QString &) { return false; }
+  void WebSocketServer::flush(WebSocketClient &) { }
   void WebSocketServer::broadcastTextMessage(const QString &) { }
+  void WebSocketServer::broadcastTextMessage(const QString &, const QString &, const QString &, const QString &, bool, const QStringList &) { }
   quint16 WebSocketServer::port() const {  return 0; }
 #endif
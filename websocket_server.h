@@ -1,34 +1,168 @@
 #ifndef WEBSOCKET_SERVER_H
 #define WEBSOCKET_SERVER_H
 
+#include <QHash>
 #include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <deque>
 #include <vector>
+#include "resource.h"
 
 class QWebSocket;
 class QWebSocketServer;
 
+#define WS_CLIENT_PENDING_MAX_BYTES  (16 * 1024) // handed to the socket but not yet written
+#define WS_CLIENT_QUEUE_MAX_BYTES    (256 * 1024) // waiting in the client queue
+#define WS_CLIENT_QUEUE_MAX_MESSAGES 512 // waiting in the client queue
+#define WS_CLIENT_TOPICS_MAX         1024 // subscribed topics per client
+#define WS_BATCH_WINDOW_MAX          1000 // ms, longest batch window a client may request
+#define WS_BATCH_MAX_MESSAGES        256 // a batch is sent early when it has this many messages
+#define WS_EVENT_LOG_SIZE            1024 // recent messages kept for clients which resume
+
+/*! \class WebSocketMessage
+
+    A message waiting in the queue of a client.
+ */
+class WebSocketMessage
+{
+public:
+    QString text;
+    QString key; // messages with the same non empty key may be coalesced
+};
+
+/*! \class WebSocketEvent
+
+    A sent message in the event log.
+ */
+class WebSocketEvent
+{
+public:
+    quint64 seq;
+    QString text;
+    QStringList topics;
+};
+
+/*! \class WebSocketClient
+
+    A connected client and its outbound queue.
+
+    Messages are handed to the socket only while less than WS_CLIENT_PENDING_MAX_BYTES
+    are unwritten, so a slow client can't make Qt buffer unbounded data.
+    Further messages wait in the queue which is bounded in bytes and messages.
+ */
+class WebSocketClient
+{
+public:
+    WebSocketClient() : sock(0), queuedBytes(0), pendingBytes(0), dropped(0), coalesced(0), broadcastSeq(0), batchWindow(0) { }
+    QWebSocket *sock;
+    QString peer;
+    QStringList topics; // subscribed topics, "#" for all messages
+    std::deque<WebSocketMessage> queue;
+    qint64 queuedBytes;
+    qint64 pendingBytes;
+    quint32 dropped;
+    quint32 coalesced;
+    quint32 broadcastSeq; // last broadcast sent to this client, avoids duplicates
+    int batchWindow; // ms, 0 sends each message in its own frame
+    std::vector<WebSocketMessage> batch; // messages collected for the next batch frame
+    SteadyTimeRef batchDue;
+};
+
 /*! \class WebSocketServer
 
     Basic websocket server to broadcast messages to clients.
+
+    Clients receive all messages unless they send a subscribe message which limits
+    them to the listed resources and state keys, "*" or an empty list means all ids:
+
+        { "t": "subscribe",
+          "resources": { "lights": ["1", "2"], "groups": ["3"], "rooms": ["4"], "sensors": "*" },
+          "state": ["on", "bri", "buttonevent"],
+          "batch": 20 }
+
+    "groups" selects the events of the group resources themselves, "rooms" selects the
+    state changes of the lights which are members of the groups.
+    A subscribe message without resources restores receiving all messages.
+    The optional "batch" window in ms opts in to batch frames: messages of the window
+    are sent as one JSON array, a newer change of the same state key replaces the older.
+    Without it every message is sent in its own frame.
+    Subscriptions are kept in an inverted index of topics to clients:
+
+        <resource>/<id>          added, deleted and other resource events
+        <resource>/<id>/<key>    changed events of a state key
+        rooms/<group id>/<key>   changed events of a state key of a member light
+
+    where <id> and <key> may be "*".
+
+    Every message is stamped with a sequence number "seq" and kept in a ring of the
+    last WS_EVENT_LOG_SIZE messages. A client which reconnects with ws://host:port/?since=<seq>
+    or puts "since" into its subscribe message gets the messages it missed. If the ring
+    doesn't reach back to its position, or the position stems from an earlier run,
+    it gets { "t": "resync", "seq": <seq> } and has to fetch the full state.
  */
 class WebSocketServer : public QObject
 {
     Q_OBJECT
 public:
+    /*! What happens when the queue of a client is full. */
+    enum SlowClientPolicy
+    {
+        PolicyCoalesce,   //!< replace a queued message of the same resource, else drop the oldest
+        PolicyDropOldest, //!< drop the oldest queued messages
+        PolicyDisconnect  //!< close the connection
+    };
+
     explicit WebSocketServer(QObject *parent = 0);
     quint16 port() const;
+    SlowClientPolicy slowClientPolicy() const { return m_policy; }
+    void setSlowClientPolicy(SlowClientPolicy policy) { m_policy = policy; }
+    const QHash<QWebSocket*, WebSocketClient> &clients() const { return m_clients; }
+    static QString policyToString(SlowClientPolicy policy);
+    static bool policyFromString(const QString &str, SlowClientPolicy *policy);
+    quint64 sequenceNumber() const { return m_seq; }
 
 signals:
 
 public slots:
     void broadcastTextMessage(const QString &msg);
+    void broadcastTextMessage(const QString &msg, const QString &resource, const QString &id,
+                              const QString &key = QString(), bool coalesce = true,
+                              const QStringList &rooms = QStringList());
 
 private slots:
     void onNewConnection();
+    void onBytesWritten(qint64 bytes);
+    void onDisconnected();
+    void onTextMessageReceived(const QString &msg);
+    void batchTimerFired();
 
 private:
+    void addToBatch(WebSocketClient &client, const QString &msg, const QString &coalesceKey);
+    void sendBatch(WebSocketClient &client);
+    void subscribe(WebSocketClient &client, const QStringList &topics);
+    QString logMessage(const QString &msg, const QStringList &topics);
+    void replay(WebSocketClient &client, quint64 since);
+    void sendToClient(WebSocketClient &client, const QString &msg, const QString &coalesceKey);
+    void sendToTopic(const QString &topic, const QString &msg, const QString &coalesceKey);
+    void removeDeadClients();
+    void disconnectSlowClient(WebSocketClient &client);
+    bool enqueue(WebSocketClient &client, const QString &msg, const QString &key);
+    void flush(WebSocketClient &client);
+
     QWebSocketServer *srv;
-    std::vector<QWebSocket*> clients;
+    QHash<QWebSocket*, WebSocketClient> m_clients;
+    QHash<QString, QVector<QWebSocket*> > m_topics; // inverted index of subscriptions
+    QVector<QWebSocket*> m_dropClients; // disconnected or too slow
+    QVector<QWebSocket*> m_batchClients; // clients with a pending batch
+    QTimer *m_batchTimer;
+    std::deque<WebSocketEvent> m_log; // recent messages, sequence numbers without gaps
+    quint64 m_seq; // sequence number of the last message
+    quint64 m_baseSeq; // random start of the sequence numbers of this run
+    quint32 m_broadcastSeq;
+    SlowClientPolicy m_policy;
 };
 
 #endif // WEBSOCKET_SERVER_H